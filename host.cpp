@@ -17,32 +17,74 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <vector>
+#include <memory>
+#include <map>
+#include <algorithm>
+#include <tuple>
 #include <string.h>
+#include <errno.h>
 #include <getopt.h>
 #include <spawn.h>
 #include <sys/wait.h>
+#include <sys/syscall.h>
+#include <sched.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <cstddef>
+#include <cstdlib>
 #include <cmath>
 #include <ctime>
 #include <time.h>
 #include <chrono>
 #include <thread>
 #include <future>
+#include <random>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <boost/algorithm/string.hpp>
-#include "boost/filesystem.hpp"
 
 #include "experimental/xrt_device.h"
 #include "experimental/xrt_kernel.h"
 #include "experimental/xrt_bo.h"
+#include "xclbin.h"
 
 const std::string csv_history_file = "tput_history.csv";
 const std::string qor_csv_file = "data_points.csv";
-const std::string EXT = "xxxxoooo";
-const std::string TMP = "tmpxxxxoooo/";
+const std::string curve_json_file = "tput_latency_curve.json";
+const std::string SHM_PREFIX = "/xrt_testsuite_";
 #define DEFAULT_COUNT (30000)
 #define DEFAULT_BULK (32)
+#define DMA_DUPLEX (2)  // -D 2, XCL_BO_SYNC_BO_TO_DEVICE and XCL_BO_SYNC_BO_FROM_DEVICE concurrently
+#define HIST_SUB_BITS (7)
+#define HIST_MAX_BITS (40)
+#define HIST_BUCKETS ((HIST_MAX_BITS - HIST_SUB_BITS + 2) << (HIST_SUB_BITS - 1))
+#define BARRIER_TIMEOUT (300)
+#define DRAIN_TIMEOUT (10)
+#define KNEE_NOISE (0.1)
+#define CURVE_STEP (0.1)
+#define CURVE_SATURATED (0.95)
+#define CURVE_MAX_STEPS (15)
+#define DEPTH_MAX (64)
+#define AUTO_PROBE (0.25)
+#define AUTO_WORSE (0.2)
+#define AUTO_GAIN (0.02)
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << 26)
+#define MAP_HUGE_1GB (30 << 26)
+#endif
+#define MPOL_DEFAULT_ (0)  // numaif.h, which comes with libnuma-dev
+#define MPOL_BIND_ (2)
+#define MPOL_MF_MOVE_ (1 << 1)
 /*
  * default kernel name is "hello", and we assume in multiple CU and/or multiple
  * kernel case, the kernels have name "kernel_index", where 'kernel' can be hello
@@ -65,6 +107,7 @@ enum kernel_cu {
     MULTI_CU_PER_KERNEL = 1,
     MULTI_KERNEL_WITH_ONE_CU_EACH = 2,
     ONE_KERNEL_ONE_CU = 3,
+    KERNEL_CU_AUTO = 4,
 };
 
 enum kernel_run_type {
@@ -79,6 +122,45 @@ enum run_mode {
     MODE_MP = 2,
     MODE_MT = 3,
     MODE_SINGLE_RUN = 4,
+    MODE_CURVE = 5,
+    MODE_AUTO = 6,
+    MODE_BANK = 7,
+};
+
+struct Config {
+    int processes;
+    int threads;
+    int bulk;
+    bool operator<(const Config& c) const
+    {
+        return std::tie(processes, threads, bulk) < std::tie(c.processes, c.threads, c.bulk);
+    }
+};
+
+enum bo_mode {
+    BO_MODE_ILLEGAL = 0,
+    BO_MODE_DEV = 1,
+    BO_MODE_UPTR = 2,
+    BO_MODE_HUGE2M = 3,
+    BO_MODE_HUGE1G = 4,
+    BO_MODE_LOCKED = 5,
+    BO_MODE_ALL = 6,
+};
+
+enum arg_update {
+    ARG_UPDATE_ILLEGAL = 0,
+    ARG_UPDATE_NONE = 1,
+    ARG_UPDATE_SETARG = 2,
+    ARG_UPDATE_UPDATE = 3,
+    ARG_UPDATE_NEWRUN = 4,
+    ARG_UPDATE_ALL = 5,
+};
+
+enum arrival_type {
+    ARRIVAL_ILLEGAL = 0,
+    ARRIVAL_CONST = 1,
+    ARRIVAL_POISSON = 2,
+    ARRIVAL_BURST = 3,
 };
 
 static size_t get_value(std::string& szStr);
@@ -100,13 +182,456 @@ struct Param {
     std::string& kname;
     int cu_type;
     int interval;
+    double rate;
+    int arrival;
+    double target;
+    double lat_bound;
+    bool async;
+    int bo_mode;
+    std::vector<int>& banks;    // bank of the bos of thread c is banks[c % size], empty for group of arg 0
+    int arg_update;
 };
 
-struct Count {
+/*
+ * latency histogram in ns, HDR style. values below 2^HIST_SUB_BITS have their own
+ * bucket, above that each power of 2 range is split into 2^(HIST_SUB_BITS-1) linear
+ * buckets, so a recorded value is off by less than 1/64 of itself. values beyond
+ * 2^HIST_MAX_BITS ns (~18 minutes) go to the last bucket.
+ * fixed size and no pointers, so it can be merged across threads and processes.
+ */
+struct Hist {
+    size_t count;
     long min;
     long max;
-    long avg;
+    double sum;
+    uint64_t bucket[HIST_BUCKETS];
+
+    void reset()
+    {
+        memset(this, 0, sizeof(*this));
+        min = LLONG_MAX;
+        max = LLONG_MIN;
+    }
+
+    static int index(long v)
+    {
+        if (v < (1L << HIST_SUB_BITS))
+            return v < 0 ? 0 : v;
+        if (v >= (1L << HIST_MAX_BITS))
+            v = (1L << HIST_MAX_BITS) - 1;
+        int e = 63 - __builtin_clzl(v) - HIST_SUB_BITS + 1;
+        return (e << (HIST_SUB_BITS - 1)) + (v >> e);
+    }
+
+    /* highest value falls in the bucket */
+    static long value(int idx)
+    {
+        if (idx < (1 << HIST_SUB_BITS))
+            return idx;
+        int e = (idx >> (HIST_SUB_BITS - 1)) - 1;
+        long sub = idx - (e << (HIST_SUB_BITS - 1));
+        return ((sub + 1) << e) - 1;
+    }
+
+    void record(long v)
+    {
+        bucket[index(v)]++;
+        count++;
+        sum += v;
+        min = std::min(min, v);
+        max = std::max(max, v);
+    }
+
+    void merge(const Hist& h)
+    {
+        for (int i = 0; i < HIST_BUCKETS; i++)
+            bucket[i] += h.bucket[i];
+        count += h.count;
+        sum += h.sum;
+        min = std::min(min, h.min);
+        max = std::max(max, h.max);
+    }
+
+    double avg() const
+    {
+        return count ? sum / count : 0;
+    }
+
+    long percentile(double p) const
+    {
+        size_t target = std::ceil(p / 100 * count);
+        size_t c = 0;
+        if (!target)
+            target = 1;
+        for (int i = 0; i < HIST_BUCKETS; i++) {
+            c += bucket[i];
+            if (c >= target)
+                return std::max(min, std::min(max, value(i)));
+        }
+        return max;
+    }
+};
+
+const std::vector<double> percentiles = {50, 90, 99, 99.9, 99.99};
+const size_t P99 = 2; // index of 99 in percentiles
+
+/*
+ * result of one child process in multiple process run. each child owns one
+ * slot in the shared memory, slots are cache line aligned so children don't
+ * share a line.
+ */
+struct alignas(64) ProcResult {
+    int done;
+    uint64_t live; // completions so far, updated while running
+    long start;
+    long end;
     size_t count;
+    Hist hist;
+};
+
+/*
+ * shared by all the children of a multiple process run.
+ * window_start is taken when the last child starts running, window_end when the
+ * first child finishes, start_count/end_count are the total completions of all
+ * children at the two points, so the throughput over the window only covers the
+ * time all the processes were running.
+ */
+struct alignas(64) ShmHdr {
+    int arrived;
+    int go;
+    int aborted;
+    int started;
+    int finished;
+    int partial; // first child finished before the last one started
+    int window_set; // window_start and start_count are published
+    long window_start;
+    long window_end;
+    uint64_t start_count;
+    uint64_t end_count;
+};
+
+static long now_stamp()
+{
+    return std::chrono::high_resolution_clock::now().time_since_epoch().count();
+}
+
+/*
+ * POSIX shared memory holding the results of the child processes. created by
+ * the parent in run_multiple_process() with a header and one slot per child,
+ * the name is passed to the children by -S, the slot index by -I.
+ */
+class ShmResult {
+    std::string name;
+    size_t size = 0;
+    void *addr = MAP_FAILED;
+    bool owner;
+public:
+    ShmResult(const std::string& nm, int slots) : name(nm), owner(slots > 0)
+    {
+        int fd;
+        if (owner) {
+            size = sizeof(ShmHdr) + slots * sizeof(ProcResult);
+            /* left behind by a crashed run of a parent with the same pid */
+            shm_unlink(name.c_str());
+            fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (fd == -1)
+                throw std::runtime_error("shm_open " + name + " failed: " + strerror(errno));
+            if (ftruncate(fd, size) == -1) {
+                close(fd);
+                shm_unlink(name.c_str());
+                throw std::runtime_error("ftruncate " + name + " failed");
+            }
+        } else {
+            struct stat st;
+            fd = shm_open(name.c_str(), O_RDWR, 0600);
+            if (fd == -1)
+                throw std::runtime_error("shm_open " + name + " failed: " + strerror(errno));
+            if (fstat(fd, &st) == -1) {
+                close(fd);
+                throw std::runtime_error("fstat " + name + " failed");
+            }
+            size = st.st_size;
+        }
+        addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (addr == MAP_FAILED) {
+            if (owner)
+                shm_unlink(name.c_str());
+            throw std::runtime_error("mmap " + name + " failed");
+        }
+        if (owner) {
+            memset(addr, 0, sizeof(ShmHdr));
+            for (int i = 0; i < slots; i++) {
+                this->slot(i).done = 0;
+                this->slot(i).live = 0;
+                this->slot(i).hist.reset();
+            }
+        }
+    }
+
+    ~ShmResult()
+    {
+        if (addr != MAP_FAILED)
+            munmap(addr, size);
+        if (owner)
+            shm_unlink(name.c_str());
+    }
+
+    int slots() const
+    {
+        return (size - sizeof(ShmHdr)) / sizeof(ProcResult);
+    }
+
+    ShmHdr& hdr()
+    {
+        return *static_cast<ShmHdr *>(addr);
+    }
+
+    ProcResult& slot(int i)
+    {
+        if (i < 0 || i >= slots())
+            throw std::runtime_error("shm slot out of range");
+        return reinterpret_cast<ProcResult *>(static_cast<char *>(addr) + sizeof(ShmHdr))[i];
+    }
+
+    uint64_t live_total()
+    {
+        uint64_t c = 0;
+        for (int i = 0; i < slots(); i++)
+            c += __atomic_load_n(&slot(i).live, __ATOMIC_RELAXED);
+        return c;
+    }
+
+    /*
+     * start barrier, hold the child after setup (xclbin load, bo allocation)
+     * until all the children arrive, then release them together.
+     */
+    void barrier()
+    {
+        auto& h = hdr();
+        auto start = std::chrono::steady_clock::now();
+        if (__atomic_add_fetch(&h.arrived, 1, __ATOMIC_ACQ_REL) == slots())
+            __atomic_store_n(&h.go, 1, __ATOMIC_RELEASE);
+        while (!__atomic_load_n(&h.go, __ATOMIC_ACQUIRE)) {
+            if (__atomic_load_n(&h.aborted, __ATOMIC_ACQUIRE))
+                throw std::runtime_error("sibling process failed before start");
+            if (std::chrono::steady_clock::now() - start > std::chrono::seconds(BARRIER_TIMEOUT))
+                throw std::runtime_error("start barrier timeout");
+            sched_yield();
+        }
+    }
+
+    void started()
+    {
+        auto& h = hdr();
+        if (__atomic_add_fetch(&h.started, 1, __ATOMIC_ACQ_REL) == slots()) {
+            h.start_count = live_total();
+            h.window_start = now_stamp();
+            __atomic_store_n(&h.window_set, 1, __ATOMIC_RELEASE);
+        }
+    }
+
+    void finished()
+    {
+        auto& h = hdr();
+        if (__atomic_add_fetch(&h.finished, 1, __ATOMIC_ACQ_REL) == 1) {
+            h.end_count = live_total();
+            h.window_end = now_stamp();
+            h.partial = !__atomic_load_n(&h.window_set, __ATOMIC_ACQUIRE);
+        }
+    }
+
+    /* release the siblings waiting in barrier() */
+    void abort()
+    {
+        __atomic_store_n(&hdr().aborted, 1, __ATOMIC_RELEASE);
+    }
+};
+
+/* set in child process of multiple process run */
+static std::unique_ptr<ShmResult> child_shm;
+static int child_slot = -1;
+static uint64_t *live_count = nullptr;
+
+/*
+ * worker placement. -C pins the threads running cmds to the cpus in the list,
+ * round robin, counting the threads of all processes of a multiple process run.
+ * -M binds the process, and the memory it allocates, to a numa node, the one
+ * the device is attached to by default.
+ * raw syscalls rather than libnuma, a kernel without numa support fails the
+ * binding and the run goes on unbound.
+ */
+struct Placement {
+    std::vector<int> cpus;      // -C, empty to float
+    int node = -1;              // -M, -1 not bound
+    std::string node_cpus;      // cpulist of the node
+};
+static Placement placement;
+
+static std::string read_line(const std::string& path)
+{
+    std::ifstream f(path);
+    std::string line;
+    std::getline(f, line);
+    return line;
+}
+
+/* "0-3,8,10-11" */
+static std::vector<int> parse_cpulist(const std::string& str)
+{
+    std::vector<int> cpus;
+    std::vector<std::string> ranges;
+    boost::split(ranges, str, boost::is_any_of(","));
+    for (auto& r : ranges) {
+        if (r.empty())
+            continue;
+        int first, last;
+        char tail;
+        int n = sscanf(r.c_str(), "%d-%d%c", &first, &last, &tail);
+        if (n == 1)
+            last = first;
+        else if (n != 2)
+            return std::vector<int>();
+        if (first < 0 || last < first)
+            return std::vector<int>();
+        for (int c = first; c <= last; c++)
+            cpus.push_back(c);
+    }
+    return cpus;
+}
+
+/*
+ * xrt numbers the devices in pci bdf order, so the index-th bdf bound to xocl is
+ * the device. -1 when the node is unknown, eg. no numa or the driver isn't xocl
+ */
+static int device_numa_node(unsigned int index)
+{
+    std::vector<std::string> bdfs;
+    DIR *dir = opendir("/sys/bus/pci/drivers/xocl");
+    if (!dir)
+        return -1;
+    while (auto ent = readdir(dir)) {
+        std::string name = ent->d_name;
+        if (std::count(name.begin(), name.end(), ':') == 2 && name.find('.') != std::string::npos)
+            bdfs.push_back(name);
+    }
+    closedir(dir);
+    std::sort(bdfs.begin(), bdfs.end());
+    if (index >= bdfs.size())
+        return -1;
+    auto node = read_line("/sys/bus/pci/devices/" + bdfs[index] + "/numa_node");
+    return node.empty() ? -1 : std::atoi(node.c_str());
+}
+
+static int node_mask(int node, std::vector<unsigned long>& mask)
+{
+    const int bits = 8 * sizeof(unsigned long);
+    mask.assign(node / bits + 1, 0);
+    mask[node / bits] |= 1UL << (node % bits);
+    return mask.size() * bits + 1;  // the kernel takes the number of bits + 1
+}
+
+/* bind the process and its future allocations, before the device is opened */
+static void bind_node(int node)
+{
+    std::vector<unsigned long> mask;
+    int maxnode = node_mask(node, mask);
+    placement.node_cpus = read_line("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    auto cpus = parse_cpulist(placement.node_cpus);
+    if (cpus.empty() || syscall(SYS_set_mempolicy, MPOL_BIND_, mask.data(), maxnode)) {
+        std::cout << "Warning: numa node " << node << " binding failed, running unbound\n";
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto c : cpus)
+        CPU_SET(c, &set);
+    if (sched_setaffinity(0, sizeof(set), &set)) {
+        syscall(SYS_set_mempolicy, MPOL_DEFAULT_, nullptr, 0);
+        std::cout << "Warning: numa node " << node << " cpu binding failed (" << strerror(errno) << "), running unbound\n";
+        return;
+    }
+    placement.node = node;
+}
+
+/* move the pages of a mapped bo to the node, best effort */
+static void bind_bo(void *ptr, size_t sz)
+{
+    if (placement.node < 0 || !ptr)
+        return;
+    std::vector<unsigned long> mask;
+    int maxnode = node_mask(placement.node, mask);
+    long page = sysconf(_SC_PAGESIZE);
+    auto start = (uintptr_t)ptr & ~(page - 1);
+    syscall(SYS_mbind, start, (uintptr_t)ptr + sz - start, MPOL_BIND_, mask.data(), maxnode, MPOL_MF_MOVE_);
+}
+
+/* pin thread c of this process, returns the cpu or -1 */
+static int pin_thread(pthread_t thr, int c, int threads)
+{
+    if (placement.cpus.empty())
+        return -1;
+    int idx = (child_slot >= 0 ? child_slot * threads : 0) + c;
+    int cpu = placement.cpus[idx % placement.cpus.size()];
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(thr, sizeof(set), &set))
+        throw std::runtime_error("\n-C cpu " + std::to_string(cpu) + " not available");
+    return cpu;
+}
+
+/*
+ * pin the calling worker thread. a failure is kept for the thread that started it,
+ * rethrown after the join, so no exception leaves a joinable std::thread behind
+ */
+static bool pin_self(int c, int threads, std::exception_ptr& err)
+{
+    try {
+        pin_thread(pthread_self(), c, threads);
+        return true;
+    } catch (...) {
+        err = std::current_exception();
+        return false;
+    }
+}
+
+/* the -C cpus have to be in the affinity of the process, after -M binding */
+static void check_cpus()
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set))
+        throw std::runtime_error(std::string("\nsched_getaffinity failed: ") + strerror(errno));
+    for (auto c : placement.cpus) {
+        if (c >= CPU_SETSIZE || !CPU_ISSET(c, &set))
+            throw std::runtime_error("\n-C cpu " + std::to_string(c) + " not available");
+    }
+}
+
+static void printPlacement(const Param& param, const std::string& cpulist)
+{
+    std::cout << "Placement(pid: " << getpid() << "): device " << param.device_index;
+    auto node = device_numa_node(param.device_index);
+    if (node >= 0)
+        std::cout << " on numa node " << node;
+    else
+        std::cout << " on unknown numa node";
+    if (placement.node >= 0)
+        std::cout << ", process and memory bound to node " << placement.node << " (cpus " << placement.node_cpus << ")";
+    else
+        std::cout << ", process and memory unbound";
+    if (!placement.cpus.empty())
+        std::cout << ", threads pinned to cpus " << cpulist;
+    std::cout << std::endl;
+}
+
+/* result of one run, for the modes stepping on the results of previous runs */
+struct Point {
+    double offered;
+    double tput;
+    double avg;
+    std::vector<double> lat; // ms, one per percentiles
 };
 
 struct MaxT {
@@ -141,16 +666,244 @@ public:
     }
 };
 
+/*
+ * Completion queue of one thread. The xrt completion callback of each cmd pushes
+ * the index of the cmd and the completion time stamp, the thread pops whichever
+ * cmd completes first.
+ */
+class CmdQueue {
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<std::pair<uint32_t, long>> q;
+public:
+    void push(uint32_t idx, long end) {
+        /* notify with lock held, so the queue is not gone when the last pop returns */
+        std::lock_guard<std::mutex> lock(mtx);
+        q.emplace_back(idx, end);
+        if (q.size() == 1)
+            cv.notify_one();
+    }
+    bool pop(uint32_t& idx, long& end, const std::chrono::microseconds& ts) {
+        std::unique_lock<std::mutex> lock(mtx);
+        if (!cv.wait_for(lock, ts, [this] { return !q.empty(); }))
+            return false;
+        idx = q.front().first;
+        end = q.front().second;
+        q.pop_front();
+        return true;
+    }
+};
+
+/*
+ * helper threads doing the bo sync of the async dma cmds of one thread, one
+ * helper per cmd, so -b transfers are in flight. a cmd reports completion to
+ * the CmdQueue of the thread, in the order the transfers finish.
+ */
+class DmaPool {
+public:
+    DmaPool(size_t n)
+    {
+        for (size_t i = 0; i < n; i++)
+            workers.emplace_back(&DmaPool::work, this);
+    }
+
+    ~DmaPool()
+    {
+        {
+            std::lock_guard<std::mutex> lk(m);
+            stop = true;
+        }
+        cv.notify_all();
+        for (auto& w : workers)
+            w.join();
+    }
+
+    void submit(std::function<void()> job)
+    {
+        std::lock_guard<std::mutex> lk(m);
+        jobs.push_back(std::move(job));
+        cv.notify_one();
+    }
+
+private:
+    std::mutex m;
+    std::condition_variable cv;
+    std::deque<std::function<void()>> jobs;
+    std::vector<std::thread> workers;
+    bool stop = false;
+
+    void work()
+    {
+        while (true) {
+            std::unique_lock<std::mutex> lk(m);
+            cv.wait(lk, [this] { return stop || !jobs.empty(); });
+            if (jobs.empty())
+                return;
+            auto job = std::move(jobs.front());
+            jobs.pop_front();
+            lk.unlock();
+            job();
+        }
+    }
+};
+
+static const char *bo_mode_name(int mode)
+{
+    const char *name[] = {"illegal", "dev", "uptr", "huge2m", "huge1g", "locked", "all"};
+    return name[mode];
+}
+
+static size_t huge_page(int mode)
+{
+    return mode == BO_MODE_HUGE1G ? 1UL << 30 : (mode == BO_MODE_HUGE2M ? 1UL << 21 : getpagesize());
+}
+
+/*
+ * host memory of a user pointer bo, released by the deleter after the bo.
+ * uptr: page aligned heap; huge2m/huge1g: hugetlb pages, need pages reserved in
+ * /sys/kernel/mm/hugepages; locked: prefaulted and mlock'ed, needs RLIMIT_MEMLOCK
+ */
+static std::shared_ptr<void> host_mem(size_t sz, int mode)
+{
+    if (mode == BO_MODE_UPTR) {
+        void *ptr = nullptr;
+        if (posix_memalign(&ptr, getpagesize(), sz))
+            throw std::runtime_error("\n-B uptr allocation failed");
+        return std::shared_ptr<void>(ptr, free);
+    }
+
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    size_t page = huge_page(mode);
+    if (mode == BO_MODE_HUGE2M) {
+        flags |= MAP_HUGETLB | MAP_HUGE_2MB;
+    } else if (mode == BO_MODE_HUGE1G) {
+        flags |= MAP_HUGETLB | MAP_HUGE_1GB;
+    } else {
+        flags |= MAP_POPULATE;
+    }
+    size_t len = (sz + page - 1) & ~(page - 1);
+    void *ptr = mmap(nullptr, len, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (ptr == MAP_FAILED)
+        throw std::runtime_error(std::string("\n-B ") + bo_mode_name(mode) + " allocation failed: " + strerror(errno));
+    if (mode == BO_MODE_LOCKED && mlock(ptr, len)) {
+        munmap(ptr, len);
+        throw std::runtime_error(std::string("\n-B locked mlock failed: ") + strerror(errno));
+    }
+    return std::shared_ptr<void>(ptr, [len](void *p) { munmap(p, len); });
+}
+
+/*
+ * device, xclbin, kernels and bos shared by all the runs of a test, so the
+ * sweep in tput and mt mode pays the xclbin load and the bo allocation once.
+ * bos are pooled by memory group and size, a run asks for the idx-th bo of a
+ * pool, and bos are allocated only when the pool is not big enough.
+ */
+class Session {
+public:
+    xrt::device device;
+    xrt::uuid uuid;
+    double load_ms;
+    double alloc_ms = 0;    // bo allocation, including the host memory and pinning of user pointer bos
+
+    Session(const Param& param) : device(param.device_index)
+    {
+        Timer timer_ld;
+        uuid = device.load_xclbin(param.xclbin_file);
+        timer_ld.stop();
+        load_ms = timer_ld.elapsed();
+        std::cout << "xclbin loaded in " << load_ms << " ms (pid: " << getpid() << ")\n";
+    }
+
+    const xrt::kernel& kernel(const std::string& name)
+    {
+        auto it = kernels.find(name);
+        if (it == kernels.end())
+            it = kernels.emplace(name, xrt::kernel(device, uuid.get(), name, false)).first;
+        return it->second;
+    }
+
+    xrt::bo& bo(size_t sz, int grp, size_t idx, int mode)
+    {
+        auto& pool = bos[std::make_tuple(grp, sz, mode)];
+        while (pool.size() <= idx) {
+            Timer timer;
+            HostBo hbo;
+            if (mode == BO_MODE_DEV) {
+                hbo.bo = xrt::bo(device, sz, 0, grp);
+            } else {
+                bool huge = mode == BO_MODE_HUGE2M || mode == BO_MODE_HUGE1G;
+                hbo.mem = huge ? huge_mem(sz, mode) : host_mem(sz, mode);
+                hbo.bo = xrt::bo(device, hbo.mem.get(), sz, 0, grp);
+            }
+            pool.push_back(std::move(hbo));
+            timer.stop();
+            alloc_ms += timer.elapsed();
+        }
+        return pool[idx].bo;
+    }
+
+    /* release the bos of other sizes or modes, eg. dma test running with a new bo size */
+    void trim(size_t sz, int mode)
+    {
+        bool erased = false;
+        for (auto it = bos.begin(); it != bos.end();) {
+            if (std::get<1>(it->first) != sz || std::get<2>(it->first) != mode) {
+                it = bos.erase(it);
+                erased = true;
+            } else {
+                it++;
+            }
+        }
+        /* new bos go to new chunks, an old chunk is released with its last bo */
+        if (erased)
+            arenas.clear();
+    }
+
+private:
+    struct HostBo {
+        std::shared_ptr<void> mem;  // null for device allocated bo
+        xrt::bo bo;                 // released before mem
+    };
+    struct Arena {
+        std::shared_ptr<void> chunk;
+        size_t size;
+        size_t used;
+    };
+    std::map<std::string, xrt::kernel> kernels;
+    std::map<std::tuple<int, size_t, int>, std::vector<HostBo>> bos;
+    std::map<int, Arena> arenas;    // by bo mode, hugepage ones only
+
+    /*
+     * hugepage bos are carved page aligned out of the chunk of the mode, so a 4k bo
+     * doesn't take a whole 2M/1G page. a new chunk of hugepages is mapped when the
+     * bo doesn't fit in the one left.
+     */
+    std::shared_ptr<void> huge_mem(size_t sz, int mode)
+    {
+        size_t page = getpagesize();
+        size_t len = (sz + page - 1) & ~(page - 1);
+        auto& arena = arenas[mode];
+        if (!arena.chunk || arena.used + len > arena.size) {
+            size_t huge = huge_page(mode);
+            arena.size = (len + huge - 1) & ~(huge - 1);
+            arena.chunk = host_mem(arena.size, mode);
+            arena.used = 0;
+        }
+        std::shared_ptr<void> mem(arena.chunk, (char *)arena.chunk.get() + arena.used);
+        arena.used += len;
+        return mem;
+    }
+};
+
 class Cmd {
 public:    
-    Cmd(const xrtDeviceHandle& device, const xrt::kernel& kernel, std::string& szStr,
-       bool latency, int dir) :
-       kernel(kernel), lat(latency), bosync((xclBOSyncDirection)dir)
+    /* arg is the index of the kernel arg taking the bo */
+    Cmd(const xrt::kernel& kernel, xrt::bo& bo, Hist *hist, int dir, int arg = 0) :
+       kernel(kernel), hist(hist), bosync((xclBOSyncDirection)dir), bo_arg(arg), bo(bo)
     {
-        auto sz = get_value(szStr);
-        bo = xrt::bo(device, sz, 0, kernel.group_id(0));
         hptr = bo.map();
-        bo_size = sz;
+        bo_size = bo.size();
+        bind_bo(hptr, bo_size);
     }
 
     void run()
@@ -161,6 +914,15 @@ public:
             run_kernel_test();
     }
 
+    /*
+     * open loop, latency is measured from the time the cmd was supposed to be
+     * issued, not from the time it is issued
+     */
+    void run_at(long intended)
+    {
+        run_kernel_test(intended);
+    }
+
     bool done()
     {
         if (is_dma_test())
@@ -175,45 +937,108 @@ public:
             kernel_wait();
     }
 
-    Count count = {LLONG_MAX, LLONG_MIN, 0, 0};
+    /*
+     * completion is reported to the queue instead of being polled by done()
+     * must be called before the first run()
+     */
+    void attach(CmdQueue *q, uint32_t i, DmaPool *p = nullptr)
+    {
+        queue = q;
+        idx = i;
+        pool = p;
+    }
+
+    /*
+     * the bo arg swaps between the bo and alt before each start, by set_arg on
+     * the run, update_arg on the run, or a new run
+     */
+    void churn(int mode, xrt::bo& alt)
+    {
+        update = mode;
+        alt_bo = alt;
+    }
+
+    void complete(long end)
+    {
+        if (hist)
+            update_lat(end);
+        count++;
+    }
+
+    bool is_dma_test() const
+    {
+        return (bosync == XCL_BO_SYNC_BO_TO_DEVICE || bosync == XCL_BO_SYNC_BO_FROM_DEVICE);
+    }
+
+    size_t count = 0;
 
 private:
     xrt::kernel kernel;
     xrt::run cmd;
-    bool lat;
+    Hist *hist; // latency of the thread, null for throughput test
     xclBOSyncDirection bosync;
     long stamp = 0;
+    CmdQueue *queue = nullptr;
+    uint32_t idx = 0;
+    DmaPool *pool = nullptr;
+    int update = ARG_UPDATE_NONE;
+    xrt::bo alt_bo;
+    bool use_alt = false;
+    int bo_arg;
 
     xrt::bo bo;
     void *hptr;
     size_t bo_size;
 
-    bool is_dma_test()
-    {
-        return (bosync == XCL_BO_SYNC_BO_TO_DEVICE || bosync == XCL_BO_SYNC_BO_FROM_DEVICE);
-    }
-
     void run_dma_test()
     {
-        if (lat)
+        if (hist)
             stamp = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+        if (pool) {
+            pool->submit([this] {
+                bo.sync(bosync, bo_size, 0);
+                queue->push(idx, std::chrono::high_resolution_clock::now().time_since_epoch().count());
+            });
+            return;
+        }
         bo.sync(bosync, bo_size, 0);
-        count.count++;
-        if (lat) {
+        count++;
+        if (hist) {
             auto end = std::chrono::high_resolution_clock::now().time_since_epoch().count();
             update_lat(end);
         }
     }
 
-    void run_kernel_test()
+    /* callback has to be in place before the first start */
+    void new_run(xrt::bo& arg)
     {
-        if (cmd)
-            cmd.start();
-        else
-            cmd = kernel(bo);
-        
-        if (lat)
-            stamp = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+        cmd = xrt::run(kernel);
+        cmd.set_arg(bo_arg, arg);
+        auto q = queue;
+        auto i = idx;
+        cmd.add_callback(ERT_CMD_STATE_COMPLETED,
+            [q, i](const void *, ert_cmd_state, void *) {
+                q->push(i, std::chrono::high_resolution_clock::now().time_since_epoch().count());
+            }, nullptr);
+    }
+
+    void run_kernel_test(long intended = 0)
+    {
+        if (!cmd) {
+            new_run(bo);
+        } else if (update != ARG_UPDATE_NONE) {
+            use_alt = !use_alt;
+            auto& arg = use_alt ? alt_bo : bo;
+            if (update == ARG_UPDATE_SETARG)
+                cmd.set_arg(bo_arg, arg);
+            else if (update == ARG_UPDATE_UPDATE)
+                cmd.update_arg(bo_arg, arg);
+            else
+                new_run(arg);
+        }
+        if (hist)
+            stamp = intended ? intended : std::chrono::high_resolution_clock::now().time_since_epoch().count();
+        cmd.start();
     }
 
     bool kernel_done()
@@ -224,11 +1049,11 @@ private:
             case ERT_CMD_STATE_COMPLETED:
             case ERT_CMD_STATE_ERROR:
             case ERT_CMD_STATE_ABORT:
-                if (lat) {
+                if (hist) {
                     auto end = std::chrono::high_resolution_clock::now().time_since_epoch().count();
                     update_lat(end);
                 }
-                count.count++;
+                count++;
                 return true;
             default:
                 break;
@@ -243,10 +1068,7 @@ private:
 
     void update_lat(long end)
     {
-        auto delta = end - stamp;
-        count.min = std::min(count.min, delta);
-        count.max = std::max(count.max, delta);
-        count.avg = (delta + count.count * count.avg) / (count.count + 1);
+        hist->record(end - stamp);
     }
 
 };
@@ -300,6 +1122,9 @@ void usage(char* exename)
     std::cout << "\t           1|mc: multiple cus in one kernel\n";
     std::cout << "\t           2|mk: multiple kernels with one cu per kernel\n";
     std::cout << "\t           3: one kernel with one cu.\n";
+    std::cout << "\t           4|auto: the cus found in the xclbin (IP_LAYOUT and CONNECTIVITY sections),\n";
+    std::cout << "\t                 any naming. each worker (thread, or process with -p) takes the next cu,\n";
+    std::cout << "\t                 bos in the bank of the cu, throughput is reported per cu\n";
     std::cout << "\t           when mc or mk type is specified, in multile process and/or thread run, each thread will\n";
     std::cout << "\t           take a different cu\n";
     std::cout << "\t           with default type, in multile process and/or thread run, each thread will take the default\n";
@@ -311,13 +1136,42 @@ void usage(char* exename)
     std::cout << "\t-p <processes>, specifying number of processes spawned, optional, default is 1\n";
     std::cout << "\t-T <second>, specifying number of second the test will run, exclusive to -n, optional\n";
     std::cout << "\t-L if specified, will test latency\n";
+    std::cout << "\t           min, max, avg and p50/p90/p99/p99.9/p99.99 latency are reported\n";
     std::cout << "\t-K <run type> optional, default is 2\n";
     std::cout << "\t           1|dma: dma test\n";
     std::cout << "\t           2|kernel: kernel execution test\n";
     std::cout << "\t-N <kernel/cu name> optional,\n";
     std::cout << "\t            default for one cu per kernel is \"hello:{hello_1}\"\n";
     std::cout << "\t            default for multiple cu per kernel is \"hello_1:{hello_1_1}\"\n";
+    std::cout << "\t-B <bo mode>, optional, default is 1\n";
+    std::cout << "\t           1|dev: bo allocated by the driver\n";
+    std::cout << "\t           2|uptr: user pointer bo of page aligned heap memory\n";
+    std::cout << "\t           3|huge2m: user pointer bo of 2MB hugepages\n";
+    std::cout << "\t           4|huge1g: user pointer bo of 1GB hugepages\n";
+    std::cout << "\t           5|locked: user pointer bo of prefaulted and locked memory\n";
+    std::cout << "\t           6|all: run with each mode, reporting allocation time, bandwidth and latency\n";
+    std::cout << "\t-U <arg update>, kernel execution changing the bo arg before each start, optional,\n";
+    std::cout << "\t           default is 1\n";
+    std::cout << "\t           1|none: the arg of the run is set once\n";
+    std::cout << "\t           2|setarg: set_arg on the run\n";
+    std::cout << "\t           3|update: update_arg on the run\n";
+    std::cout << "\t           4|newrun: a new run with the arg set\n";
+    std::cout << "\t           5|all: run with each of them, reporting ops/s, latency and the cost over none\n";
+    std::cout << "\t-a, asynchronous dma, -b transfers in flight per thread, each synced by a helper thread\n";
+    std::cout << "\t           and completing out of order. with -m tput, sweep the queue depth from 1 to " << DEPTH_MAX << "\n";
+    std::cout << "\t           for -s bo size instead of the bo sizes\n";
     std::cout << "\t-D <dma dir> 0: to device, 1: from device. optional, default is bi-direction\n";
+    std::cout << "\t           2: duplex, to device and from device concurrently, -t threads each, reported\n";
+    std::cout << "\t              per direction and aggregate, with the slowdown against the direction alone\n";
+    std::cout << "\t              with -n the faster direction finishes first, -T keeps both busy to the end\n";
+    std::cout << "\t-R <ops/s>, open loop kernel execution with offered load of ops/s per process, optional\n";
+    std::cout << "\t           cmds are issued on a precomputed schedule instead of after a cmd completes,\n";
+    std::cout << "\t           up to -b cmds in flight per thread, with -L latency is measured from the\n";
+    std::cout << "\t           scheduled issue time, so queueing delay is counted\n";
+    std::cout << "\t-A <arrival> arrival schedule of -R, optional, default is const\n";
+    std::cout << "\t           1|const: fixed gap between cmds\n";
+    std::cout << "\t           2|poisson: exponentially distributed gap\n";
+    std::cout << "\t           3|burst: -b cmds arrive at once\n";
     std::cout << "\t-m <mode>, optional, default is 4\n";
     std::cout << "\t           1|tput: throughput test\n"; 
     std::cout << "\t                   for kernel execution, run with different bulk size from 1 ,2, 4, all the way up to 256\n"; 
@@ -331,26 +1185,57 @@ void usage(char* exename)
     std::cout << "\t                     eg. -t 4, will run 1, 2, 4 threads\n"; 
     std::cout << "\t                     eg. -t 9, will run 1, 2, 4, 8, 16 threads\n"; 
     std::cout << "\t           4:      single run with specified -b, -n | -T, -t, -p, -L, -K\n";
+    std::cout << "\t           5|curve: throughput vs latency curve of kernel execution\n";
+    std::cout << "\t                   closed loop run for the peak throughput, then open loop runs (see -R)\n";
+    std::cout << "\t                   with offered load from 10% of the peak up, until the throughput\n";
+    std::cout << "\t                   can't follow. the knee is the last load before p99 latency grows\n";
+    std::cout << "\t                   faster than throughput. the curve is saved in " << curve_json_file << "\n";
+    std::cout << "\t           6|auto: autotune cmd queue length, threads and processes of kernel execution,\n";
+    std::cout << "\t                   searching powers of 2 up to -b, -t and -p adaptively\n";
+    std::cout << "\t                     with -O, the cheapest config reaching the target throughput\n";
+    std::cout << "\t                     with -P, the highest throughput with p99 latency under the bound\n";
+    std::cout << "\t           7|bank: dma bandwidth matrix of the memory banks in the xclbin, each bank alone,\n";
+    std::cout << "\t                   then the first 2, 4... and all banks at once with -t threads per bank,\n";
+    std::cout << "\t                   h2c and c2h, bo size 64k, 1m, 16m, 64m or the one of -s\n";
+    std::cout << "\t-O <ops/s>, target throughput of -m auto, optional\n";
+    std::cout << "\t-P <ms>, p99 latency bound of -m auto, optional\n";
+    std::cout << "\t-C <cpulist>, pin the threads running cmds to the cpus, eg. 0-3,8, optional\n";
+    std::cout << "\t           round robin over the threads of all processes\n";
+    std::cout << "\t-M <node|auto>, bind processes and memory to the numa node, optional\n";
+    std::cout << "\t           auto: the node the device is attached to, found from sysfs\n";
     std::cout << "\t-h, help\n\n";
 }
 
-static void saveProcessResult(const Timer& timer, const Count& res)
-{
-    std::string file = TMP;
-    file += std::to_string(getppid());
-    file += "_";
-    file += std::to_string(getpid());
-    file += EXT;
-    if (!boost::filesystem::exists(TMP))
-        boost::filesystem::create_directory(TMP);
-    std::ofstream handle(file);
-    handle << timer.start.time_since_epoch().count() << "\n";
-    handle << timer.end.time_since_epoch().count() << "\n";
-    handle << res.min << "\n";
-    handle << res.max << "\n";
-    handle << res.avg << "\n";
-    handle << res.count << "\n";
-    handle.close();
+static void saveProcessResult(const Timer& timer, size_t count, const Hist& res)
+{
+    auto& slot = child_shm->slot(child_slot);
+    slot.start = timer.start.time_since_epoch().count();
+    slot.end = timer.end.time_since_epoch().count();
+    slot.count = count;
+    slot.hist = res;
+    __atomic_store_n(&slot.done, 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * latency part of the result, min, max, percentiles and avg. one json line per
+ * value in csv file, the last one (avg) is written by the caller.
+ */
+static void printLatency(const Hist& res, std::string& line, std::ofstream& handle)
+{
+    std::cout << "\tcount: " << res.count << std::endl;
+    line += "\"count\": " + std::to_string(res.count) + ", ";
+    std::cout << "\tmin: " << (double)res.min / 1000000 << " ms\n";
+    handle << line + "\"min_ms\": " + std::to_string((double)res.min / 1000000) + "}\n";
+    std::cout << "\tmax: " << (double)res.max / 1000000 << " ms\n";
+    handle << line + "\"max_ms\": " + std::to_string((double)res.max / 1000000) + "}\n";
+    for (auto p : percentiles) {
+        std::ostringstream name;
+        name << "p" << p;
+        std::cout << "\t" << name.str() << ": " << (double)res.percentile(p) / 1000000 << " ms\n";
+        handle << line + "\"" + name.str() + "_ms\": " + std::to_string((double)res.percentile(p) / 1000000) + "}\n";
+    }
+    std::cout << "\tavg: " << res.avg() / 1000000 << " ms\n";
+    line += "\"avg_ms\": " + std::to_string(res.avg() / 1000000);
 }
 
 static void printCsvTitle(const Param& param)
@@ -360,11 +1245,16 @@ static void printCsvTitle(const Param& param)
 
     std::ofstream handle(qor_csv_file, std::ofstream::app);
     std::string line;
-    if (param.mode == MODE_MT) {
+    if (param.mode == MODE_CURVE) {
+        line += "curve_";
+    } else if (param.mode == MODE_MT) {
         line += "multi_thread_";
     } else if (param.mode == MODE_MP) {
         line += "multi_process_";
     }
+    if (param.rate) {
+        line += "open_loop_";
+    }
     if (param.run_type == RUN_TYPE_DMA) {
         line += "DMA\n";
     } else {
@@ -375,33 +1265,306 @@ static void printCsvTitle(const Param& param)
     } else {
         line += "latency\n";
     }
-    handle << line;
-    handle.close();
+    handle << line;
+    handle.close();
+}
+
+static const char *arg_update_name(int update)
+{
+    const char *name[] = {"illegal", "none", "setarg", "update", "newrun", "all"};
+    return name[update];
+}
+
+static const char *arrival_name(int arrival)
+{
+    if (arrival == ARRIVAL_POISSON)
+        return "poisson";
+    if (arrival == ARRIVAL_BURST)
+        return "burst";
+    return "const";
+}
+
+static void printOfferedLoad(const Param& param, std::string& line)
+{
+    if (!param.rate)
+        return;
+    std::cout << "\toffered load: " << param.rate * param.processes << " ops/s (";
+    std::cout << arrival_name(param.arrival) << " arrival)\n";
+    line += "\"arrival\": \"" + std::string(arrival_name(param.arrival)) + "\", ";
+    line += "\"offered_op_per_sec\": " + std::to_string(param.rate * param.processes) + ", ";
+}
+
+/* the whole xclbin file, checked to be a xclbin */
+static std::vector<char> read_xclbin(const std::string& xclbin)
+{
+    std::ifstream f(xclbin, std::ios::binary);
+    std::vector<char> buf((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    auto top = reinterpret_cast<const axlf *>(buf.data());
+    if (buf.size() < sizeof(axlf) || strncmp(top->m_magic, "xclbin2", 8))
+        throw std::runtime_error("\n" + xclbin + " is not a xclbin");
+    return buf;
+}
+
+/*
+ * the sections of the kind in the xclbin read by read_xclbin(), with their sizes.
+ * section headers or sections beyond the end of the file are ignored.
+ */
+static std::vector<std::pair<const char *, uint64_t>> xclbin_sections(const std::vector<char>& buf, uint32_t kind)
+{
+    std::vector<std::pair<const char *, uint64_t>> secs;
+    auto top = reinterpret_cast<const axlf *>(buf.data());
+    for (uint32_t i = 0; i < top->m_header.m_numSections; i++) {
+        if (offsetof(axlf, m_sections) + (i + 1) * sizeof(axlf_section_header) > buf.size())
+            break;
+        auto& sec = top->m_sections[i];
+        if (sec.m_sectionKind == kind && sec.m_sectionOffset <= buf.size() &&
+            sec.m_sectionSize <= buf.size() - sec.m_sectionOffset)
+            secs.emplace_back(buf.data() + sec.m_sectionOffset, sec.m_sectionSize);
+    }
+    return secs;
+}
+
+/* a section of size holds its count and count entries of size entry from offset head */
+static void check_section(const std::string& xclbin, const char *kind, uint64_t size,
+    size_t head, int32_t count, size_t entry)
+{
+    if (size < head || count < 0 || (size - head) / entry < (uint64_t)count)
+        throw std::runtime_error("\n" + xclbin + ": " + kind + " section truncated or corrupt");
+}
+
+struct Bank {
+    int index;          // memory group of the bo
+    std::string tag;
+    uint64_t size_kb;
+};
+
+/* the memory banks in use by the xclbin, from its MEM_TOPOLOGY section */
+static std::vector<Bank> mem_banks(const std::string& xclbin)
+{
+    std::vector<Bank> banks;
+    auto buf = read_xclbin(xclbin);
+    for (auto sec : xclbin_sections(buf, MEM_TOPOLOGY)) {
+        auto topo = reinterpret_cast<const mem_topology *>(sec.first);
+        check_section(xclbin, "MEM_TOPOLOGY", sec.second, offsetof(mem_topology, m_mem_data),
+            sec.second < sizeof(int32_t) ? 0 : topo->m_count, sizeof(mem_data));
+        for (int m = 0; m < topo->m_count; m++) {
+            auto& mem = topo->m_mem_data[m];
+            if (!mem.m_used || mem.m_type == MEM_STREAMING || mem.m_type == MEM_STREAMING_CONNECTION)
+                continue;
+            banks.push_back({m, std::string((const char *)mem.m_tag, strnlen((const char *)mem.m_tag, 16)),
+                mem.m_size});
+        }
+    }
+    return banks;
+}
+
+/*
+ * a cu of the xclbin, from the IP_LAYOUT section, and the memory group of each of
+ * its args connected to memory or stream, from the CONNECTIVITY section
+ */
+struct CuInfo {
+    std::string kernel;
+    std::string cu;
+    std::vector<std::pair<int, int>> args;  // arg index, memory group
+    int bo_arg;     // the first arg connected to memory, taking the bo of the cmds, -1 for none
+    int bo_bank;
+    std::string name() const { return kernel + ":{" + cu + "}"; }
+};
+
+/* the cus of -c auto, worker c (thread, or process of a multiple process run) takes cus[c % size] */
+static std::vector<CuInfo> xclbin_cus;
+
+static std::vector<CuInfo> find_cus(const std::string& xclbin)
+{
+    std::vector<CuInfo> cus;
+    std::vector<int> ip_cu;     // ip layout index to index in cus, -1 for an ip not a cu
+    auto buf = read_xclbin(xclbin);
+    for (auto sec : xclbin_sections(buf, IP_LAYOUT)) {
+        auto layout = reinterpret_cast<const ip_layout *>(sec.first);
+        check_section(xclbin, "IP_LAYOUT", sec.second, offsetof(ip_layout, m_ip_data),
+            sec.second < sizeof(int32_t) ? 0 : layout->m_count, sizeof(ip_data));
+        for (int i = 0; i < layout->m_count; i++) {
+            auto& ip = layout->m_ip_data[i];
+            std::string name((const char *)ip.m_name, strnlen((const char *)ip.m_name, 64));
+            auto pos = name.find(":");
+            if (ip.m_type != IP_KERNEL || pos == std::string::npos) {
+                ip_cu.push_back(-1);
+                continue;
+            }
+            ip_cu.push_back(cus.size());
+            cus.push_back({name.substr(0, pos), name.substr(pos + 1), {}, -1, -1});
+        }
+    }
+    for (auto sec : xclbin_sections(buf, CONNECTIVITY)) {
+        auto conn = reinterpret_cast<const connectivity *>(sec.first);
+        check_section(xclbin, "CONNECTIVITY", sec.second, offsetof(connectivity, m_connection),
+            sec.second < sizeof(int32_t) ? 0 : conn->m_count, sizeof(connection));
+        for (int i = 0; i < conn->m_count; i++) {
+            auto& c = conn->m_connection[i];
+            if (c.m_ip_layout_index < 0 || c.m_ip_layout_index >= (int)ip_cu.size() ||
+                ip_cu[c.m_ip_layout_index] < 0)
+                continue;
+            cus[ip_cu[c.m_ip_layout_index]].args.emplace_back(c.arg_index, c.mem_data_index);
+        }
+    }
+    std::vector<int> mems;
+    for (auto& b : mem_banks(xclbin))
+        mems.push_back(b.index);
+    for (auto& cu : cus) {
+        std::sort(cu.args.begin(), cu.args.end());
+        for (auto& a : cu.args) {
+            if (std::find(mems.begin(), mems.end(), a.second) != mems.end()) {
+                cu.bo_arg = a.first;
+                cu.bo_bank = a.second;
+                break;
+            }
+        }
+    }
+    return cus;
+}
+
+/* the cu of -c auto by its kernel/cu name */
+static const CuInfo *find_cu(const std::string& name)
+{
+    for (auto& cu : xclbin_cus) {
+        if (cu.name() == name)
+            return &cu;
+    }
+    return nullptr;
+}
+
+static void printCus(const std::string& xclbin)
+{
+    std::map<int, std::string> tags;
+    for (auto& b : mem_banks(xclbin))
+        tags[b.index] = b.tag;
+    std::cout << "cu(s) found in xclbin: " << xclbin_cus.size() << std::endl;
+    for (size_t i = 0; i < xclbin_cus.size(); i++) {
+        std::cout << "	" << i << ": " << xclbin_cus[i].name() << ", args:";
+        for (auto& a : xclbin_cus[i].args) {
+            std::cout << " " << a.first << "->";
+            if (tags.count(a.second))
+                std::cout << tags[a.second];
+            else
+                std::cout << "stream";
+        }
+        std::cout << std::endl;
+    }
+}
+
+/*
+ * kernel/cu name worker c (0 based) runs, following the naming convention of the
+ * cu layout of -c, or the cu found in the xclbin for -c auto
+ */
+static std::string cu_kname(const Param& param, int c)
+{
+    std::string kname = param.kname;
+    if (param.cu_type == MULTI_CU_PER_KERNEL) {
+        kname = kname.substr(0, kname.find(":"));
+        kname = kname + ":{" + kname + "_" + std::to_string(c+1) + "}";
+    } else if (param.cu_type == MULTI_KERNEL_WITH_ONE_CU_EACH) {
+        kname = kname.substr(0, kname.find("_"));
+        kname = kname + "_" +std::to_string(c+1) + ":{" + kname + "_" + std::to_string(c+1) + "_1}";
+    } else if (param.cu_type == KERNEL_CU_AUTO) {
+        kname = xclbin_cus[c % xclbin_cus.size()].name();
+    }
+    return kname;
+}
+
+/* Jain's fairness index of the throughputs, 1 when all are equal, 1/n when one gets all */
+static double jain_index(const std::vector<double>& tput)
+{
+    double sum = 0, sq = 0;
+    for (auto t : tput) {
+        sum += t;
+        sq += t * t;
+    }
+    return sq ? sum * sum / (tput.size() * sq) : 1;
+}
+
+/*
+ * throughput of each thread, cu or process, with -L also its p50 and p99 latency, then
+ * the fairness over them, Jain's index and the max/min ratio of the throughputs.
+ * kernel execution in ops/s, dma in MB/s.
+ */
+static void printBreakdown(const Param& param, const std::string& unit, const std::string& units,
+    const std::vector<std::string>& names, const std::vector<double>& tput, const std::vector<Hist>& hists,
+    std::ofstream& handle)
+{
+    bool dma = param.dir == XCL_BO_SYNC_BO_TO_DEVICE || param.dir == XCL_BO_SYNC_BO_FROM_DEVICE;
+    double scale = dma ? get_value(param.bo_sz) / 1000000.0 : 1;
+    std::string key = dma ? "bandwidth_MB_per_sec" : "throughput_op_per_sec";
+    std::cout << "\tper " << unit << ":\n";
+    for (size_t i = 0; i < names.size(); i++) {
+        std::string line = "{\"" + unit + "\": \"" + names[i] + "\", \"" + key + "\": " + std::to_string(tput[i] * scale);
+        std::cout << "\t  " << names[i] << ": " << tput[i] * scale << (dma ? " MB/s" : " ops/s");
+        if (param.latency && hists[i].count) {
+            std::cout << ", p50 " << (double)hists[i].percentile(50) / 1000000 << " ms";
+            std::cout << ", p99 " << (double)hists[i].percentile(99) / 1000000 << " ms";
+            line += ", \"p50_ms\": " + std::to_string((double)hists[i].percentile(50) / 1000000);
+            line += ", \"p99_ms\": " + std::to_string((double)hists[i].percentile(99) / 1000000);
+        }
+        std::cout << std::endl;
+        handle << line + "}\n";
+    }
+    auto mm = std::minmax_element(tput.begin(), tput.end());
+    double ratio = *mm.first > 0 ? *mm.second / *mm.first : INFINITY;
+    std::cout << "\tfairness over " << names.size() << " " << units;
+    std::cout << ": jain index " << jain_index(tput);
+    std::cout << ", max/min " << ratio << std::endl;
+    handle << "{\"fairness\": \"" + unit + "\", \"jain_index\": " + std::to_string(jain_index(tput)) +
+        ", \"max_min_ratio\": " + std::to_string(ratio) + "}\n";
+}
+
+/*
+ * per worker (thread or process) and per cu breakdown of a run, a cu gets the sum of
+ * the workers on it. ids are the indexes of the workers with a result.
+ */
+static void printWorkerResult(const Param& param, const std::string& unit, const std::string& units,
+    const std::vector<int>& ids, const std::vector<double>& tput, const std::vector<Hist>& hists,
+    const std::vector<std::string>& cu_names, std::ofstream& handle)
+{
+    std::vector<std::string> names, cus;
+    std::vector<double> cu_tput;
+    std::vector<Hist> cu_hists;
+    for (size_t c = 0; c < tput.size(); c++) {
+        names.push_back(std::to_string(ids[c]) + " (" + cu_names[c] + ")");
+        auto it = std::find(cus.begin(), cus.end(), cu_names[c]);
+        if (it == cus.end()) {
+            cus.push_back(cu_names[c]);
+            cu_tput.push_back(tput[c]);
+            cu_hists.push_back(hists[c]);
+        } else {
+            cu_tput[it - cus.begin()] += tput[c];
+            cu_hists[it - cus.begin()].merge(hists[c]);
+        }
+    }
+    if (names.size() > 1)
+        printBreakdown(param, unit, units, names, tput, hists, handle);
+    if (param.cu_type != ONE_KERNEL_ONE_CU && cus.size() > 1)
+        printBreakdown(param, "cu", "cus", cus, cu_tput, cu_hists, handle);
 }
 
-static void printResult(const Param& param, const Timer& timer, const std::vector<std::vector<Cmd>>& cmds, MaxT& maxT)
+static void printResult(const Param& param, const Timer& timer, const std::vector<std::vector<Cmd>>& cmds,
+    const std::vector<Hist>& hists, const std::vector<long>& ends, const std::vector<std::string>& cu_names,
+    MaxT& maxT, Point *point)
 {
-    Count res = {LLONG_MAX, LLONG_MIN, 0, 0};
+    Hist res;
+    size_t count = 0;
+    std::vector<size_t> counts;
+    res.reset();
     for (auto& t : cmds) {
         size_t c = 0;
-        for (auto& t1: t) {
-            c += t1.count.count;
-            if (param.latency) {
-                /*
-                std::cout << "min: " << t1.count.min;
-                std::cout << " max " << t1.count.max;
-                std::cout << " avg: " << t1.count.avg;
-                std::cout << " count: " << t1.count.count;
-                std::cout << "\n";
-                */
-                res.min = std::min(res.min, t1.count.min);
-                res.max = std::max(res.max, t1.count.max);
-                res.avg = (res.avg * res.count + t1.count.avg * t1.count.count) / (res.count + t1.count.count);
-            }
-            res.count += t1.count.count;
-        }
+        for (auto& t1: t)
+            c += t1.count;
         if (!param.time && c != (size_t)param.loop)
             throw std::runtime_error("per thread count calculation error");
+        count += c;
+        counts.push_back(c);
+    }
+    if (param.latency) {
+        for (auto& h : hists)
+            res.merge(h);
     }
     if (!param.quiet) {
         std::ofstream handle(qor_csv_file, std::ofstream::app);
@@ -424,6 +1587,22 @@ static void printResult(const Param& param, const Timer& timer, const std::vecto
         line += "\"process\": " + std::to_string(param.processes) + ", ";
         std::cout <<  "\tthread(s) per process: " << param.threads << std::endl;
         line += "\"thread\": " + std::to_string(param.threads) + ", ";
+        if (!param.banks.empty()) {
+            std::string banks;
+            for (auto b : param.banks)
+                banks += (banks.empty() ? "" : ",") + std::to_string(b);
+            std::cout << "\tmemory bank(s): " << banks << std::endl;
+            line += "\"banks\": \"" + banks + "\", ";
+        }
+        if (param.arg_update != ARG_UPDATE_NONE) {
+            std::cout << "\targ update: " << arg_update_name(param.arg_update) << std::endl;
+            line += "\"arg_update\": \"" + std::string(arg_update_name(param.arg_update)) + "\", ";
+        }
+        if (param.bo_mode != BO_MODE_DEV) {
+            std::cout << "\tbo mode: " << bo_mode_name(param.bo_mode) << std::endl;
+            line += "\"bo_mode\": \"" + std::string(bo_mode_name(param.bo_mode)) + "\", ";
+        }
+        printOfferedLoad(param, line);
         if (!param.latency) {
             if (param.dir == XCL_BO_SYNC_BO_TO_DEVICE ||
                 param.dir == XCL_BO_SYNC_BO_FROM_DEVICE) {
@@ -431,17 +1610,17 @@ static void printResult(const Param& param, const Timer& timer, const std::vecto
                 line += "\"bo_size\": \"" + param.bo_sz + "\", ";
                 std::cout << "\tbandwidth: ";
                 line += "\"bandwidth_MB_per_sec\": ";
-                std::cout << res.count * get_value(param.bo_sz) / timer.elapsed() / 1000 << " MB/s (";
-                std::cout << res.count << " transfers in " << timer.elapsed() << " ms)\n";
-                line +=  std::to_string(res.count * get_value(param.bo_sz) / timer.elapsed() / 1000);
+                std::cout << count * get_value(param.bo_sz) / timer.elapsed() / 1000 << " MB/s (";
+                std::cout << count << " transfers in " << timer.elapsed() << " ms)\n";
+                line +=  std::to_string(count * get_value(param.bo_sz) / timer.elapsed() / 1000);
             } else {
                 std::cout << "\tqueue length: " << param.bulk << std::endl;
                 line += "\"queue_length\": " + std::to_string(param.bulk) + ", ";
                 std::cout << "\tthroughput: ";
                 line += "\"throughput_op_per_sec\": ";
-                std::cout << res.count / timer.elapsed() * 1000 << " ops/s (";
-                std::cout << res.count << " executions in " << timer.elapsed() << " ms)\n";
-                line += std::to_string(res.count / timer.elapsed() * 1000);
+                std::cout << count / timer.elapsed() * 1000 << " ops/s (";
+                std::cout << count << " executions in " << timer.elapsed() << " ms)\n";
+                line += std::to_string(count / timer.elapsed() * 1000);
             }
         } else {
             if (param.dir == XCL_BO_SYNC_BO_TO_DEVICE ||
@@ -452,31 +1631,144 @@ static void printResult(const Param& param, const Timer& timer, const std::vecto
                 std::cout << "\tqueue length: " << param.bulk << std::endl;
                 line += "\"queue_length\": " + std::to_string(param.bulk) + ", ";
             }
-            std::cout << "\tcount: " << res.count << std::endl;
-            line += "\"count\": " + std::to_string(res.count) + ", ";
-            std::cout << "\tmin: " << (double)res.min / 1000000 << " ms\n";
-            handle << line + "\"min_ms\": " + std::to_string((double)res.min / 1000000) + "}\n";
-            std::cout << "\tmax: " << (double)res.max / 1000000 << " ms\n";
-            handle << line + "\"max_ms\": " + std::to_string((double)res.max / 1000000) + "}\n";
-            std::cout << "\tavg: " << (double)res.avg / 1000000 << " ms\n";
-            line += "\"avg_ms\": " + std::to_string((double)res.avg / 1000000);
+            printLatency(res, line, handle);
         }
         line += "}\n";
         handle << line;
+        /* with -n each thread is timed to its own end, with -T all count over the same period */
+        std::vector<double> tput;
+        std::vector<int> ids;
+        for (size_t c = 0; c < counts.size(); c++) {
+            double ms = timer.elapsed();
+            if (!param.time && ends[c] > timer.start.time_since_epoch().count())
+                ms = (ends[c] - timer.start.time_since_epoch().count()) / 1000000.0;
+            tput.push_back(counts[c] / ms * 1000);
+            ids.push_back(c);
+        }
+        printWorkerResult(param, "thread", "threads", ids, tput, hists, cu_names, handle);
         handle.close();
     }
-    saveProcessResult(timer, res); // for multiple process
+    if (child_shm)
+        saveProcessResult(timer, count, res); // for multiple process
     MaxT nmaxT = {
         param.processes,
         param.threads,
         param.bulk,
-        res.count * 1000 /timer.elapsed(),
+        count * 1000 /timer.elapsed(),
     };
     if (nmaxT.tput > maxT.tput)
         maxT = std::move(nmaxT);
+    if (point) {
+        point->offered = param.rate;
+        point->tput = nmaxT.tput;
+        point->avg = res.avg() / 1000000;
+        point->lat.clear();
+        for (auto p : percentiles)
+            point->lat.push_back((double)res.percentile(p) / 1000000);
+    }
             
 }
 
+/*
+ * async dma queue depth sweep, h2c[i] and c2h[i] are the results of depth 2^i.
+ * a direction saturates at the first depth reaching CURVE_SATURATED of its best.
+ */
+static void showDepthResult(const Param& param, const std::vector<Point>& h2c, const std::vector<Point>& c2h)
+{
+    auto sz = get_value(param.bo_sz);
+    double best[2] = {0, 0};
+    int sat[2] = {0, 0};
+    const std::vector<Point> *pts[] = {&h2c, &c2h};
+    for (int d = 0; d < 2; d++) {
+        for (auto& pt : *pts[d])
+            best[d] = std::max(best[d], pt.tput);
+        for (size_t i = 0; i < pts[d]->size(); i++) {
+            if ((*pts[d])[i].tput >= best[d] * CURVE_SATURATED) {
+                sat[d] = 1 << i;
+                break;
+            }
+        }
+    }
+
+    std::cout << "\nAsync DMA queue depth, bo size: " << param.bo_sz << ", thread(s): " << param.threads << "\n";
+    std::cout << "\tdepth\th2c MB/s\th2c p99 ms\tc2h MB/s\tc2h p99 ms\n";
+    for (size_t i = 0; i < h2c.size(); i++) {
+        std::cout << "\t" << (1 << i) << "\t" << h2c[i].tput * sz / 1000000 << "\t" << h2c[i].lat[P99];
+        std::cout << "\t\t" << c2h[i].tput * sz / 1000000 << "\t" << c2h[i].lat[P99] << "\n";
+    }
+    std::cout << "h2c saturates at depth " << sat[0] << " (" << best[0] * sz / 1000000 << " MB/s max), ";
+    std::cout << "c2h saturates at depth " << sat[1] << " (" << best[1] * sz / 1000000 << " MB/s max)\n";
+}
+
+/*
+ * result of a duplex run, the time of a direction ends when its last thread is
+ * done. point[0] is h2c, point[1] c2h and point[2] both directions over the run
+ */
+static void duplexResult(const Param& param, const Timer& timer, const std::vector<std::vector<Cmd>>& cmds,
+    const std::vector<Hist>& hists, const std::vector<long>& ends, Point *point)
+{
+    if (!point)
+        return;
+    long start = timer.start.time_since_epoch().count();
+    size_t total = 0;
+    for (int d = 0; d < 2; d++) {
+        Hist res;
+        size_t count = 0;
+        long end = start + 1;
+        res.reset();
+        for (int c = d * param.threads; c < (d + 1) * param.threads; c++) {
+            for (auto& cmd : cmds[c])
+                count += cmd.count;
+            res.merge(hists[c]);
+            end = std::max(end, ends[c]);
+        }
+        total += count;
+        point[d].offered = 0;
+        point[d].tput = count * 1e9 / (end - start);
+        point[d].avg = res.avg() / 1000000;
+        point[d].lat.clear();
+        for (auto p : percentiles)
+            point[d].lat.push_back((double)res.percentile(p) / 1000000);
+    }
+    point[2].offered = 0;
+    point[2].tput = total * 1000 / timer.elapsed();
+    point[2].avg = 0;
+    point[2].lat.clear();
+}
+
+/* solo[] are the results of each direction run alone */
+static void printDuplexResult(const Param& param, const Point solo[2], const Point both[3])
+{
+    auto sz = get_value(param.bo_sz);
+    const char *name[] = {"h2c", "c2h"};
+    std::ofstream handle(qor_csv_file, std::ofstream::app);
+    std::string line = "{\"direction\": \"duplex\", ";
+
+    std::cout << "\nDMA duplex " << (param.latency ? "latency" : "throughput") << ":\n";
+    std::cout << "\tthread(s) per direction: " << param.threads << std::endl;
+    line += "\"thread\": " + std::to_string(param.threads) + ", ";
+    std::cout << "\tbo size: " << param.bo_sz << std::endl;
+    line += "\"bo_size\": \"" + param.bo_sz + "\", ";
+    for (int d = 0; d < 2; d++) {
+        double bw = both[d].tput * sz / 1000000;
+        double alone = solo[d].tput * sz / 1000000;
+        std::cout << "\t" << name[d] << " bandwidth: " << bw << " MB/s (alone " << alone;
+        std::cout << " MB/s, slowdown " << alone / bw << "x)\n";
+        line += "\"" + std::string(name[d]) + "_MB_per_sec\": " + std::to_string(bw) + ", ";
+        line += "\"" + std::string(name[d]) + "_slowdown\": " + std::to_string(alone / bw) + ", ";
+        if (param.latency) {
+            std::cout << "\t" << name[d] << " latency avg: " << both[d].avg << " ms, p99: ";
+            std::cout << both[d].lat[P99] << " ms (alone " << solo[d].lat[P99] << " ms)\n";
+            line += "\"" + std::string(name[d]) + "_p99_ms\": " + std::to_string(both[d].lat[P99]) + ", ";
+        }
+    }
+    std::cout << "\taggregate bandwidth: " << both[2].tput * sz / 1000000 << " MB/s\n";
+    line += "\"bandwidth_MB_per_sec\": " + std::to_string(both[2].tput * sz / 1000000);
+    line += "}\n";
+    handle << line;
+    handle.close();
+}
+
 static void getHostname(char host[256])
 {
     memset(host, 0, 256);
@@ -515,64 +1807,122 @@ static void showTputResult(const Param& param, const MaxT& maxT)
     handle.close();
 }
 
+/*
+ * knee of the curve, the last point before the relative growth of p99 latency
+ * exceeds the relative growth of throughput (and the noise level)
+ */
+static size_t find_knee(const std::vector<Point>& points)
+{
+    for (size_t i = 1; i < points.size(); i++) {
+        auto& a = points[i - 1];
+        auto& b = points[i];
+        double lat_growth = a.lat[P99] ? (b.lat[P99] - a.lat[P99]) / a.lat[P99] : 0;
+        double tput_growth = (b.tput - a.tput) / a.tput;
+        if (lat_growth > KNEE_NOISE && lat_growth > tput_growth)
+            return i - 1;
+    }
+    return points.size() - 1;
+}
+
+/*
+ * throughput vs latency curve, printed as table and saved as json
+ */
+static void showCurveResult(const Param& param, double peak, const std::vector<Point>& points)
+{
+    auto knee = find_knee(points);
+    std::ofstream handle(curve_json_file);
+    std::cout << "\nThroughput vs latency (closed loop peak: " << peak << " ops/s)\n";
+    std::cout << "\toffered ops/s\tthroughput ops/s";
+    for (auto p : percentiles)
+        std::cout << "\tp" << p << " ms";
+    std::cout << "\n";
+    handle << "{\"xclbin\": \"" << param.xclbin_file << "\", ";
+    handle << "\"thread\": " << param.threads << ", ";
+    handle << "\"queue_length\": " << param.bulk << ", ";
+    handle << "\"arrival\": \"" << arrival_name(param.arrival) << "\", ";
+    handle << "\"peak_op_per_sec\": " << peak << ", ";
+    handle << "\"knee\": " << knee << ", ";
+    handle << "\"points\": [";
+    for (size_t i = 0; i < points.size(); i++) {
+        auto& pt = points[i];
+        std::cout << (i == knee ? "knee ->\t" : "\t") << pt.offered << "\t\t" << pt.tput;
+        handle << (i ? ", " : "") << "{\"offered_op_per_sec\": " << pt.offered;
+        handle << ", \"throughput_op_per_sec\": " << pt.tput;
+        for (size_t j = 0; j < percentiles.size(); j++) {
+            std::cout << "\t" << pt.lat[j];
+            handle << ", \"p" << percentiles[j] << "_ms\": " << pt.lat[j];
+        }
+        std::cout << "\n";
+        handle << ", \"avg_ms\": " << pt.avg << "}";
+    }
+    handle << "]}\n";
+    handle.close();
+    std::cout << "\nKnee: " << points[knee].tput << " ops/s @ offered " << points[knee].offered;
+    std::cout << " ops/s, p99 " << points[knee].lat[P99] << " ms\n";
+}
+
 /*
  * For multiple process case, the overhead of setup and teardown of a process is not negligible,
- * we should not count the time as part of the time run. The way we are doing is, each child process
- * saves the start and end time and number of executions, the parent process gets the earliest start
- * and latest end as the period. This way is still not accurate.
- * Better way is the driver can provide number of executions with a tool, like custat.
+ * we should not count the time as part of the time run. The children wait on a barrier after
+ * setup and are released together, then the throughput is counted over the window from the last
+ * child starting to the first child finishing, with the completions of all the children in it.
+ * If there is no such window (one child finished before another started), the earliest start and
+ * latest end are used as the period instead.
  */   
-static void handleProcessResult(const Param& param)
+static void handleProcessResult(const Param& param, ShmResult& shm, Point *point)
 {
     double min = LLONG_MAX, max = LLONG_MIN;
-    double count = 0, avg = 0, tcount, tavg;
-    boost::filesystem::directory_iterator dir(TMP), end;
-    while (dir != end) {
-        std::string fn = dir->path().filename().string();
-        if (fn.rfind(EXT) != std::string::npos) {
-            //std::cout << "fn: " << fn << " pid: " << getpid() << std::endl;
-            /*
-             * contents save in file
-             * 1 timer_start (throughput)
-             * 2 timer_end (throughput) 
-             * 3 lat_min (latency)
-             * 4 lat_max (latency)
-             * 5 lat_avg (latency)
-             * 6 count (throughput, latency)
-             */  
-            if (fn.find(std::to_string(getpid()) + "_") != std::string::npos) {
-                std::ifstream f(TMP + fn);
-                if (f.is_open()) {
-                    std::string ret;
-                    std::getline(f, ret); // 1
-                    if (!param.latency)
-                        min = std::min(min, std::atof(ret.c_str()));	
-                    std::getline(f, ret); // 2
-                    if (!param.latency)
-                        max = std::max(max, std::atof(ret.c_str()));	
-                    std::getline(f, ret); // 3
-                    if (param.latency)
-                        min = std::atof(ret.c_str());
-                    std::getline(f, ret); // 4
-                    if (param.latency)
-                        max = std::atof(ret.c_str());
-                    std::getline(f, ret); // 5
-                    if (param.latency)
-                        tavg = std::atof(ret.c_str());
-                    std::getline(f, ret); // 6
-                    tcount = std::atof(ret.c_str());
-                    if (param.latency)
-                        avg = (avg * count + tavg * tcount) / (tcount + count);	
-                    count += tcount;
-                    f.close();
-                }
-            }
-            boost::filesystem::remove_all(dir->path());
+    double count = 0;
+    int done = 0;
+    Hist res;
+    res.reset();
+    for (int c = 0; c < shm.slots(); c++) {
+        auto& slot = shm.slot(c);
+        if (!__atomic_load_n(&slot.done, __ATOMIC_ACQUIRE))
+            continue;
+        min = std::min(min, (double)slot.start);
+        max = std::max(max, (double)slot.end);
+        count += slot.count;
+        if (param.latency)
+            res.merge(slot.hist);
+        done++;
+    }
+    if (done != shm.slots())
+        std::cout << "Warning: " << shm.slots() - done << " process(es) reported no result\n";
+    if (!done)
+        throw std::runtime_error("no result from child processes");
+
+    auto& hdr = shm.hdr();
+    bool window = done == shm.slots() && !hdr.partial && hdr.window_end > hdr.window_start;
+    std::ostringstream active;
+    if (point) {
+        point->offered = param.rate * param.processes;
+        if (window)
+            point->tput = (hdr.end_count - hdr.start_count) * 1000000000.0 / (hdr.window_end - hdr.window_start);
+        else
+            point->tput = count * 1000000000 / (max - min);
+        point->avg = res.avg() / 1000000;
+        point->lat.clear();
+        for (auto p : percentiles)
+            point->lat.push_back((double)res.percentile(p) / 1000000);
+    }
+    if (!param.latency) {
+        for (int c = 0; c < shm.slots(); c++) {
+            auto& slot = shm.slot(c);
+            if (!slot.done)
+                continue;
+            active << "\tprocess " << c << " active: " << (slot.end - slot.start) / 1000000.0;
+            active << " ms, from +" << (slot.start - min) / 1000000 << " ms (";
+            active << slot.count << " completions)\n";
+        }
+        if (window) {
+            min = hdr.window_start;
+            max = hdr.window_end;
+            count = hdr.end_count - hdr.start_count;
+        } else {
+            active << "\tprocesses didn't overlap, earliest start and latest end are used\n";
         }
-        dir++;
     }
-    if (boost::filesystem::exists(TMP))
-        boost::filesystem::remove_all(TMP);
 
     std::ofstream handle(qor_csv_file, std::ofstream::app);
     std::string line = "{";
@@ -594,6 +1944,8 @@ static void handleProcessResult(const Param& param)
     line += "\"process\": " + std::to_string(param.processes) + ", ";
     std::cout <<  "\tthread(s) per process: " << param.threads << std::endl;
     line += "\"thread\": " + std::to_string(param.threads) + ", ";
+    printOfferedLoad(param, line);
+    std::cout << active.str();
     if (!param.latency) {
         if (param.dir == XCL_BO_SYNC_BO_TO_DEVICE ||
             param.dir == XCL_BO_SYNC_BO_FROM_DEVICE) {
@@ -620,17 +1972,26 @@ static void handleProcessResult(const Param& param)
             std::cout << "\tqueue length: " << param.bulk << std::endl;
             line += "\"queue_length\": " + std::to_string(param.bulk) + ", ";
         }
-        std::cout << "\tcount: " << count << std::endl;
-        line += "\"count\": " + std::to_string(count) + ", ";
-        std::cout << "\tmin: " << (double)min / 1000000 << " ms\n";
-        handle << line + "\"min_ms\": " + std::to_string((double)min / 1000000) + "}\n";
-        std::cout << "\tmax: " << (double)max / 1000000 << " ms\n";
-        handle << line + "\"max_ms\": " + std::to_string((double)max / 1000000) + "}\n";
-        std::cout << "\tavg: " << (double)avg / 1000000 << " ms\n";
-        line += "\"avg_ms\": " + std::to_string((double)avg / 1000000);
+        printLatency(res, line, handle);
     }
     line += "}\n";
     handle << line;
+
+    /* each process over its own active time, the cu of a process is the one passed with -N */
+    std::vector<double> tput;
+    std::vector<Hist> hists;
+    std::vector<std::string> cu_names;
+    std::vector<int> ids;
+    for (int c = 0; c < shm.slots(); c++) {
+        auto& slot = shm.slot(c);
+        if (!slot.done)
+            continue;
+        tput.push_back(slot.end > slot.start ? slot.count * 1000000000.0 / (slot.end - slot.start) : 0);
+        hists.push_back(slot.hist);
+        cu_names.push_back(cu_kname(param, c));
+        ids.push_back(c);
+    }
+    printWorkerResult(param, "process", "processes", ids, tput, hists, cu_names, handle);
     handle.close();
 }
 
@@ -650,6 +2011,12 @@ static int get_mode(const char* str)
         return MODE_MP;
     if (!strcasecmp(str, "mt"))
         return MODE_MT;
+    if (!strcasecmp(str, "curve"))
+        return MODE_CURVE;
+    if (!strcasecmp(str, "auto"))
+        return MODE_AUTO;
+    if (!strcasecmp(str, "bank"))
+        return MODE_BANK;
     return std::atoi(str);
 }
 
@@ -662,12 +2029,43 @@ static int get_run_type(const char* str)
     return std::atoi(str);
 }
 
+static int get_arrival(const char* str)
+{
+    if (!strcasecmp(str, "const"))
+        return ARRIVAL_CONST;
+    if (!strcasecmp(str, "poisson"))
+        return ARRIVAL_POISSON;
+    if (!strcasecmp(str, "burst"))
+        return ARRIVAL_BURST;
+    return std::atoi(str);
+}
+
 static int get_cu_type(const char* str)
 {
     if (!strcasecmp(str, "mc"))
         return MULTI_CU_PER_KERNEL;
     if (!strcasecmp(str, "mk"))
         return MULTI_KERNEL_WITH_ONE_CU_EACH;
+    if (!strcasecmp(str, "auto"))
+        return KERNEL_CU_AUTO;
+    return std::atoi(str);
+}
+
+static int get_arg_update(const char* str)
+{
+    for (int u = ARG_UPDATE_NONE; u <= ARG_UPDATE_ALL; u++) {
+        if (!strcasecmp(str, arg_update_name(u)))
+            return u;
+    }
+    return std::atoi(str);
+}
+
+static int get_bo_mode(const char* str)
+{
+    for (int m = BO_MODE_DEV; m <= BO_MODE_ALL; m++) {
+        if (!strcasecmp(str, bo_mode_name(m)))
+            return m;
+    }
     return std::atoi(str);
 }
 
@@ -692,26 +2090,27 @@ static void regulate_dma_run_param(Param& param, bool force = false)
 }
 
 static int
-run_multiple_process(std::vector<char*>& argv, char *envp[], const Param& param)
+run_multiple_process(std::vector<char*>& argv, char *envp[], const Param& param, Point *point = nullptr)
 {
     pid_t pids[param.processes];
     int c, status;
     std::string kname = param.kname;
+    std::string shm_name = SHM_PREFIX + std::to_string(getpid());
+    ShmResult shm(shm_name, param.processes);
+    std::string slot;
 
     for (c = 0; c < param.processes; c++) {
         argv.push_back((char *)"-N");
-        kname = param.kname;
-        if (param.cu_type == MULTI_CU_PER_KERNEL) {
-            kname = kname.substr(0, kname.find(":"));
-            kname = kname + ":{" + kname + "_" + std::to_string(c+1) + "}";
-        } else if (param.cu_type == MULTI_KERNEL_WITH_ONE_CU_EACH) {
-            kname = kname.substr(0, kname.find("_"));
-            kname = kname + "_" +std::to_string(c+1) + ":{" + kname + "_" + std::to_string(c+1) + "_1}";
-        }
+        kname = cu_kname(param, c);
         argv.push_back(&kname[0]);
+        slot = std::to_string(c);
+        argv.push_back((char *)"-S");
+        argv.push_back(&shm_name[0]);
+        argv.push_back((char *)"-I");
+        argv.push_back(&slot[0]);
+        argv.push_back(NULL);
         status = posix_spawn(&pids[c], argv.data()[0], NULL, NULL, argv.data(), envp);
-        argv.pop_back();
-        argv.pop_back();
+        argv.resize(argv.size() - 7);
         if (status) {
             std::cerr << "status: " << status << std::endl;
             throw std::runtime_error("posix_spawn failed");
@@ -719,47 +2118,110 @@ run_multiple_process(std::vector<char*>& argv, char *envp[], const Param& param)
         //std::cout << "process: " << pids[c] << " spawned..." << std::endl;
     }
 
+    /*
+     * a child killed or failing before the barrier would keep its siblings waiting
+     * there till the timeout, so they are released on the first failure. the slots
+     * of a failed run are not merged.
+     */
+    int failed = 0;
     for (c = 0; c < param.processes; c++) {
         if (waitpid(pids[c], &status, 0) == -1)
             throw std::runtime_error("waitpid failed");
         //std::cout << "process: " << pids[c] << " exited." << std::endl;
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+            continue;
+        if (!failed++)
+            shm.abort();
+        if (WIFSIGNALED(status))
+            std::cout << "process " << pids[c] << " killed by signal " << WTERMSIG(status) << std::endl;
+        else
+            std::cout << "process " << pids[c] << " exited with " << WEXITSTATUS(status) << std::endl;
     }
+    if (failed)
+        throw std::runtime_error("\n" + std::to_string(failed) + " of " + std::to_string(param.processes) +
+            " processes failed");
 
-    handleProcessResult(param);
+    handleProcessResult(param, shm, point);
 
     return 0;
 }
 
+/*
+ * If time (-T) is spedified, after timer expires, still make sure all cmds complete.
+ * but we don't count them.
+ * the queue has to outlive all the callbacks, so it is drained rather than cmd.wait().
+ * a cmd still not complete DRAIN_TIMEOUT seconds later is stuck, give up instead of
+ * hanging the test.
+ */
+static void
+drain(CmdQueue& queue, size_t outstanding)
+{
+    auto start = std::chrono::steady_clock::now();
+    uint32_t c;
+    long end;
+    while (outstanding) {
+        if (queue.pop(c, end, std::chrono::milliseconds(1000))) {
+            outstanding--;
+        } else if (std::chrono::steady_clock::now() - start > std::chrono::seconds(DRAIN_TIMEOUT)) {
+            if (child_shm)
+                child_shm->abort();
+            std::cout << outstanding << " cmd(s) not complete " << DRAIN_TIMEOUT << "s after -T expired\n";
+            std::cout << "Test failed(pid: " << getpid() << ")!!" << std::endl;
+            std::_Exit(EXIT_FAILURE);
+        }
+    }
+}
+
 /*
  * cmds are pre-filled, so overhead of the cu param setup is not counted.
  * when running, all the cmds in the queue will be sent to the cu before starting
  * to check the cmd status. then once a cmd is complete, the same cmd will be issued
  * again.
- * a loop is used to check all the cmds one by one -- this is not an efficient way though
+ * kernel cmds report completion to the queue of the thread from the xrt callback,
+ * the thread re-issues whichever cmd completes first, so a slow cmd doesn't block
+ * the ones already complete behind it.
+ * dma cmds complete synchronously in run(), a loop is used to check them one by one,
+ * unless async (-a), then they are run by the DmaPool of the thread and report to
+ * the queue as well. the pool is created by run() before the timer starts.
  */ 
 static void
-thr0(std::vector<Cmd>& cmds, int loop, const Timer& timer, int interval)
+thr0(std::vector<Cmd>& cmds, int loop, const Timer& timer, int interval, DmaPool *pool)
 {
+    CmdQueue queue;
+    bool event = !cmds[0].is_dma_test() || pool;
     int issued = 0, completed = 0;
     uint32_t c = 0;
     int target = interval;
     int last = 0;
     for (auto& cmd : cmds) {
+        if (event)
+            cmd.attach(&queue, c++, pool);
         cmd.run();
         issued++;
     }
 
     c = 0;
     while (!loop || completed < loop) {
-        if (cmds[c].done()) {
+        bool done;
+        if (event) {
+            long end;
+            done = queue.pop(c, end, std::chrono::milliseconds(10));
+            if (done)
+                cmds[c].complete(end);
+        } else {
+            done = cmds[c].done();
+        }
+        if (done) {
                 completed++;
+                if (live_count)
+                    __atomic_fetch_add(live_count, 1, __ATOMIC_RELAXED);
                 if (!loop || issued < loop) {
                     cmds[c].run();
                     issued++;
                 }
         }    
 
-        if (++c == cmds.size())
+        if (!event && ++c == cmds.size())
             c = 0;
         if (target && timer.expire(target)) {
             target += interval;
@@ -770,82 +2232,569 @@ thr0(std::vector<Cmd>& cmds, int loop, const Timer& timer, int interval)
             break;
         }
     }
-    /*
-     * If time (-T) is spedified, after timer expires, still make sure all cmds complete.
-     * but we don't count them.
-     */  
+    /* see drain() */
     if (!loop) {
+        if (event)
+            drain(queue, issued - completed);
         for (auto& cmd : cmds) {
             cmd.wait(); 
         }
     }
 }
 
-static int run(const Param& param, MaxT& maxT)
+/*
+ * intended issue time (ns from start) of each cmd of one thread in open loop run.
+ * the rate of -R is split evenly among the threads.
+ * const: fixed gap; poisson: exponential gap; burst: -b cmds arrive together, then
+ * wait for -b gaps, so the average rate is the same.
+ */
+static std::vector<long>
+make_schedule(const Param& param, size_t n, unsigned int seed)
+{
+    std::vector<long> sched;
+    double gap = 1e9 * param.threads / param.rate;
+    std::mt19937_64 gen(seed);
+    std::exponential_distribution<double> exp(1.0 / gap);
+    double t = 0;
+    sched.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        sched.push_back(t);
+        if (param.arrival == ARRIVAL_POISSON)
+            t += exp(gen);
+        else if (param.arrival == ARRIVAL_BURST) {
+            if ((i + 1) % param.bulk == 0)
+                t += gap * param.bulk;
+        } else
+            t += gap;
+    }
+    return sched;
+}
+
+/*
+ * open loop, cmds are issued on the schedule regardless of completions. when an
+ * arrival is due and no cmd is free, it waits for one, and the time waiting is
+ * counted in its latency.
+ */
+static void
+thr_open(std::vector<Cmd>& cmds, const std::vector<long>& sched, const Timer& timer)
+{
+    CmdQueue queue;
+    std::vector<uint32_t> free;
+    size_t next = 0, completed = 0, issued = 0;
+    long t0 = timer.start.time_since_epoch().count();
+    uint32_t c;
+    long end;
+    for (c = 0; c < cmds.size(); c++) {
+        cmds[c].attach(&queue, c);
+        free.push_back(c);
+    }
+
+    while (completed < sched.size()) {
+        long now = now_stamp();
+        while (next < sched.size() && !free.empty() && t0 + sched[next] <= now) {
+            cmds[free.back()].run_at(t0 + sched[next]);
+            free.pop_back();
+            next++;
+            issued++;
+        }
+
+        /* wake up a bit early and spin, timed wait oversleeps by tens of us */
+        long wait = 10000000;
+        if (next < sched.size() && !free.empty())
+            wait = std::min(wait, t0 + sched[next] - now - 50000);
+        if (queue.pop(c, end, std::chrono::microseconds(std::max(wait / 1000, 0L)))) {
+            cmds[c].complete(end);
+            free.push_back(c);
+            completed++;
+            if (live_count)
+                __atomic_fetch_add(live_count, 1, __ATOMIC_RELAXED);
+        }
+        if (timer.expire())
+            break;
+    }
+    /* same as thr0, outstanding cmds complete but are not counted */
+    drain(queue, issued - completed);
+}
+
+static int run(Session& session, const Param& param, MaxT& maxT, Point *point = nullptr)
 {
-    auto device = xrt::device(param.device_index);
-    Timer timer_ld;
-    auto uuid = device.load_xclbin(param.xclbin_file);
-    timer_ld.stop();
-    auto krnl = xrt::kernel(device, uuid.get(), param.kname, false);
+    auto krnl = session.kernel(param.kname);
+    auto sz = get_value(param.bo_sz);
     int c; 
     int bulk = std::min(param.bulk, param.loop);
-    std::cout << "Test running...(pid: " << getpid() <<", xclbin loaded in " << timer_ld.elapsed() << " ms)\n";
+    std::cout << "Test running...(pid: " << getpid() << ")\n";
+    session.trim(sz, param.bo_mode);
     std::vector<std::thread> thrs;
 
     /*
      * populate the cmd queue before hand for each thread.
      */  
+    /*
+     * duplex dma has -t threads for each direction, h2c ones first.
+     */  
     std::vector<std::vector<Cmd>> cmds;
-    for (c = 0; c < param.threads; c++) {
+    bool duplex = param.dir == DMA_DUPLEX;
+    int groups = duplex ? param.threads * 2 : param.threads;
+    std::vector<Hist> hists(groups);
+    std::vector<long> ends(groups);
+    std::vector<std::string> cu_names;
+    for (auto& h : hists)
+        h.reset();
+    for (c = 0; c < groups; c++) {
     	std::vector<Cmd> cmdlist;
+        int dir = param.dir;
+        if (duplex)
+            dir = c < param.threads ? XCL_BO_SYNC_BO_TO_DEVICE : XCL_BO_SYNC_BO_FROM_DEVICE;
         if (!param.quiet) { // a ugly way to tell the run is not from multiple process case
-            std::string kname = param.kname;
-            if (param.cu_type == MULTI_CU_PER_KERNEL) {
-                kname = kname.substr(0, kname.find(":"));
-                kname = kname + ":{" + kname + "_" + std::to_string(c+1) + "}";
-                krnl = xrt::kernel(device, uuid.get(), kname, false);
-            } else if (param.cu_type == MULTI_KERNEL_WITH_ONE_CU_EACH) {
-                kname = kname.substr(0, kname.find("_"));
-                kname = kname + "_" +std::to_string(c+1) + ":{" + kname + "_" + std::to_string(c+1) + "_1}";
-                krnl = xrt::kernel(device, uuid.get(), kname, false);
-            }
+            std::string kname = cu_kname(param, c % param.threads);
+            if (param.cu_type != ONE_KERNEL_ONE_CU)
+                krnl = session.kernel(kname);
             std::cout << "thread " << c <<" running kernel name: " << kname << std::endl; 
+            cu_names.push_back(kname);
         } else {
             std::cout << "thread " << c <<" running kernel name: " << param.kname << std::endl; 
+            cu_names.push_back(param.kname);
+        }
+        if (!placement.cpus.empty()) {
+            int idx = (child_slot >= 0 ? child_slot * param.threads : 0) + c;
+            std::cout << "thread " << c << " pinned to cpu " << placement.cpus[idx % placement.cpus.size()] << std::endl;
+        }
+        /* -c auto, the bo goes to the first arg of the cu connected to memory, in its bank */
+        int bo_arg = 0;
+        int bo_grp = -1;
+        if (param.cu_type == KERNEL_CU_AUTO) {
+            auto cu = find_cu(cu_names.back());
+            if (!cu || cu->bo_arg < 0)
+                throw std::runtime_error("\n-c auto: cu " + cu_names.back() + " has no arg connected to memory");
+            bo_arg = cu->bo_arg;
+            bo_grp = cu->bo_bank;
         }
     	for (int i = 0; i < bulk; i++) {
-        	auto cmd = Cmd(device, krnl, param.bo_sz, param.latency, param.dir);
+            int grp = param.banks.empty() ? (bo_grp < 0 ? krnl.group_id(0) : bo_grp) : param.banks[c % param.banks.size()];
+        	auto cmd = Cmd(krnl, session.bo(sz, grp, c * bulk + i, param.bo_mode),
+                    param.latency ? &hists[c] : nullptr, dir, bo_arg);
+        	if (param.arg_update != ARG_UPDATE_NONE)
+        	    cmd.churn(param.arg_update, session.bo(sz, grp, (groups + c) * bulk + i, param.bo_mode));
         	cmdlist.push_back(std::move(cmd));
     	}
        	cmds.push_back(std::move(cmdlist));
     }
 
+    std::vector<std::vector<long>> scheds;
+    if (param.rate) {
+        size_t n = param.time ? std::ceil(param.rate / param.threads * param.time) + bulk : param.loop;
+        /* seeded by the thread index over all the processes, or they arrive in step */
+        for (c = 0; c < param.threads; c++)
+            scheds.push_back(make_schedule(param, n, (child_slot >= 0 ? child_slot * param.threads : 0) + c + 1));
+    }
+
+    /* async dma helpers, all jobs are drained by thr0() before its queue is gone */
+    std::vector<std::unique_ptr<DmaPool>> pools(groups);
+    for (c = 0; c < groups; c++) {
+        if (param.async && cmds[c][0].is_dma_test())
+            pools[c].reset(new DmaPool(cmds[c].size()));
+    }
+
+    if (child_shm)
+        child_shm->barrier();
+
     /*
      * For multiple threads case, the time of the thread setup and tear down is also
      * counted as the time running the kernel. This impact the accuracy.
      * Better way is, driver has statistics and can be reported by a tool like, custat
      */  
     Timer timer(param.time);
+    if (child_shm)
+        child_shm->started();
     int interval = 0;
-    if (param.threads == 1) {
+    std::vector<std::exception_ptr> errs(groups);
+    if (param.rate) {
+        for (c = 0; c < param.threads; c++) {
+            thrs.emplace_back([&, c] {
+                if (!pin_self(c, param.threads, errs[c]))
+                    return;
+                thr_open(cmds[c], scheds[c], timer);
+                ends[c] = now_stamp();
+            });
+        }
+        for (auto& t : thrs)
+            t.join();
+    } else if (duplex) {
+        for (c = 0; c < groups; c++) {
+            thrs.emplace_back([&, c] {
+                if (!pin_self(c, groups, errs[c]))
+                    return;
+                thr0(cmds[c], param.time ? 0 : param.loop, timer, 0, pools[c].get());
+                ends[c] = now_stamp();
+            });
+        }
+        for (auto& t : thrs)
+            t.join();
+    } else if (param.threads == 1) {
         if (param.time > param.interval && param.run_type == RUN_TYPE_KERNEL &&
             !param.latency) //implicit feature for throughput run
             interval = param.interval;
-        thr0(cmds[0], param.time ? 0 : param.loop, timer, interval);
+        pin_thread(pthread_self(), 0, 1);
+        thr0(cmds[0], param.time ? 0 : param.loop, timer, interval, pools[0].get());
+        ends[0] = now_stamp();
     } else {
-        for (c = 0; c < param.threads; c++)
-            thrs.emplace_back(&thr0, std::ref(cmds[c]), param.time ? 0 : param.loop, std::ref(timer), interval);
+        for (c = 0; c < param.threads; c++) {
+            thrs.emplace_back([&, c] {
+                if (!pin_self(c, param.threads, errs[c]))
+                    return;
+                thr0(cmds[c], param.time ? 0 : param.loop, timer, interval, pools[c].get());
+                ends[c] = now_stamp();
+            });
+        }
         for (auto& t : thrs)
             t.join();
     }
     timer.stop();
+    for (auto& e : errs) {
+        if (e)
+            std::rethrow_exception(e);
+    }
+    if (child_shm)
+        child_shm->finished();
 
-    printResult(param, timer, cmds, maxT);
+    if (duplex) {
+        duplexResult(param, timer, cmds, hists, ends, point);
+        return 0;
+    }
+    printResult(param, timer, cmds, hists, ends, cu_names, maxT, point);
     
     return 0;
 }
 
+/*
+ * memory bank bandwidth matrix of dma. each bank alone, then the first 2, 4...
+ * and all banks concurrently, -t threads per bank, with h2c and c2h for each bo
+ * size. a size not fitting in the bank is reported as -.
+ */
+static void run_banks(Session& session, Param& param, MaxT& maxT, const std::vector<std::string>& sizes)
+{
+    auto banks = mem_banks(param.xclbin_file);
+    if (banks.empty())
+        throw std::runtime_error("\n-m bank: no memory bank in use by the xclbin");
+    std::vector<std::vector<int>> sets;
+    for (auto& b : banks)
+        sets.push_back({b.index});
+    for (size_t n = 2; n < banks.size() * 2; n *= 2) {
+        sets.push_back({});
+        for (size_t i = 0; i < std::min(n, banks.size()); i++)
+            sets.back().push_back(banks[i].index);
+    }
+
+    int threads = param.threads;
+    int dirs[] = {XCL_BO_SYNC_BO_TO_DEVICE, XCL_BO_SYNC_BO_FROM_DEVICE};
+    std::vector<std::vector<double>> matrix;    // set x (dir, size)
+    Point pt;
+    for (auto& set : sets) {
+        matrix.push_back({});
+        for (auto d : dirs) {
+            for (auto& sz : sizes) {
+                param.banks = set;
+                param.threads = threads * set.size();
+                param.bo_sz = sz;
+                param.dir = d;
+                regulate_dma_run_param(param, true);
+                try {
+                    run(session, param, maxT, &pt);
+                    matrix.back().push_back(pt.tput * get_value(param.bo_sz) / 1000000);
+                } catch (const std::exception& e) {
+                    std::cout << "Warning: bank(s) skipped," << e.what() << "\n";
+                    matrix.back().push_back(-1);
+                }
+            }
+        }
+    }
+    session.trim(0, param.bo_mode);
+    param.banks.clear();
+    param.threads = threads;
+
+    std::cout << "\nMemory bank bandwidth MB/s, thread(s) per bank: " << threads << "\n";
+    std::cout << "\tbank\ttag\t\tsize MB";
+    for (auto d : {"h2c", "c2h"})
+        for (auto& sz : sizes)
+            std::cout << "\t" << d << " " << sz;
+    std::cout << "\n";
+    for (size_t i = 0; i < sets.size(); i++) {
+        if (i < banks.size()) {
+            std::cout << "\t" << banks[i].index << "\t" << banks[i].tag;
+            std::cout << (banks[i].tag.size() < 8 ? "\t\t" : "\t") << banks[i].size_kb / 1024;
+        } else {
+            std::cout << "\t" << sets[i].size() << " banks at once\t";
+        }
+        for (auto bw : matrix[i]) {
+            std::cout << "\t";
+            if (bw < 0)
+                std::cout << "-";
+            else
+                std::cout << bw;
+        }
+        std::cout << "\n";
+    }
+}
+
+/*
+ * -U all, run with each way of updating the arg, reporting ops/s and latency
+ */
+static void run_arg_updates(Session& session, Param& param, MaxT& maxT)
+{
+    std::vector<Point> pts;
+    param.latency = true;
+    for (int u = ARG_UPDATE_NONE; u < ARG_UPDATE_ALL; u++) {
+        Point pt;
+        param.arg_update = u;
+        run(session, param, maxT, &pt);
+        pts.push_back(pt);
+    }
+    param.arg_update = ARG_UPDATE_ALL;
+
+    std::cout << "\nArg update, thread(s): " << param.threads << ", queue length: " << param.bulk << "\n";
+    std::cout << "\tupdate\tops/s\t\tavg ms\t\tp99 ms\tcost us/op\n";
+    for (size_t i = 0; i < pts.size(); i++) {
+        std::cout << "\t" << arg_update_name(ARG_UPDATE_NONE + i) << "\t" << pts[i].tput << "\t";
+        std::cout << pts[i].avg << "\t" << pts[i].lat[P99] << "\t";
+        std::cout << 1000000 / pts[i].tput - 1000000 / pts[0].tput << "\n";
+    }
+}
+
+/*
+ * -B all, run with each bo mode. a mode failing to allocate, eg. no hugepages
+ * reserved, is skipped. the allocation time is the cost of getting and pinning
+ * the memory, paid once per bo.
+ */
+static void run_bo_modes(Session& session, Param& param, MaxT& maxT)
+{
+    struct Row {
+        int mode;
+        int dir;
+        double alloc_ms;
+        Point pt;
+    };
+    std::vector<Row> rows;
+    int dir = param.dir;
+    auto sz = get_value(param.bo_sz);
+    param.latency = true;
+    for (int m = BO_MODE_DEV; m < BO_MODE_ALL; m++) {
+        std::vector<int> dirs = {dir};
+        if (param.run_type == RUN_TYPE_DMA && dir == INT_MAX)
+            dirs = {XCL_BO_SYNC_BO_TO_DEVICE, XCL_BO_SYNC_BO_FROM_DEVICE};
+        param.bo_mode = m;
+        double alloc = session.alloc_ms;
+        try {
+            /* the directions share the bos of the mode, every row shows the allocation of the mode */
+            for (auto d : dirs) {
+                Row row = {m, d, 0};
+                param.dir = d;
+                run(session, param, maxT, &row.pt);
+                row.alloc_ms = session.alloc_ms - alloc;
+                rows.push_back(row);
+            }
+        } catch (const std::exception& e) {
+            std::cout << "Warning: bo mode " << bo_mode_name(m) << " skipped," << e.what() << "\n";
+        }
+    }
+    session.trim(0, BO_MODE_DEV);
+    param.bo_mode = BO_MODE_ALL;
+    param.dir = dir;
+
+    std::cout << "\nBo modes, bo size: " << param.bo_sz << ", thread(s): " << param.threads;
+    std::cout << ", queue length: " << param.bulk << "\n";
+    std::cout << "\tmode\tdir\talloc ms\t" << (param.run_type == RUN_TYPE_DMA ? "MB/s" : "ops/s");
+    std::cout << "\tavg ms\tp99 ms\n";
+    for (auto& r : rows) {
+        const char *dname = r.dir == XCL_BO_SYNC_BO_TO_DEVICE ? "h2c" :
+            (r.dir == XCL_BO_SYNC_BO_FROM_DEVICE ? "c2h" : "-");
+        std::cout << "\t" << bo_mode_name(r.mode) << "\t" << dname << "\t" << r.alloc_ms << "\t\t";
+        std::cout << (param.run_type == RUN_TYPE_DMA ? r.pt.tput * sz / 1000000 : r.pt.tput);
+        std::cout << "\t" << r.pt.avg << "\t" << r.pt.lat[P99] << "\n";
+    }
+}
+
+/*
+ * duplex dma, each direction runs alone first, then both run concurrently with
+ * -t threads each. the slowdown of a direction is its bandwidth alone over the
+ * one in duplex.
+ */
+static void run_duplex(Session& session, Param& param, MaxT& maxT)
+{
+    Point solo[2], both[3];
+    param.dir = XCL_BO_SYNC_BO_TO_DEVICE;
+    run(session, param, maxT, &solo[0]);
+    param.dir = XCL_BO_SYNC_BO_FROM_DEVICE;
+    run(session, param, maxT, &solo[1]);
+    param.dir = DMA_DUPLEX;
+    std::cout << "\nDuplex, h2c and c2h concurrently...\n";
+    run(session, param, maxT, both);
+    printDuplexResult(param, solo, both);
+}
+
+/*
+ * argv without the options in opts and their values, the options stripped all
+ * take a value, "" for -L
+ */
+static std::vector<char*> strip_opts(const std::vector<char*>& argv, const std::string& opts)
+{
+    std::vector<char*> nargv;
+    for (size_t i = 0; i < argv.size(); i++) {
+        if (i && argv[i][0] == '-' && argv[i][1] && !argv[i][2] && opts.find(argv[i][1]) != std::string::npos) {
+            i++;
+            continue;
+        }
+        nargv.push_back(argv[i]);
+    }
+    return nargv;
+}
+
+/*
+ * autotune, coordinate descent on bulk, threads and processes in powers of 2,
+ * bounded by -b, -t and -p. a dimension is doubled as long as the score goes up.
+ * each config is probed with a quarter of -n/-T first, and dropped without the
+ * full run when clearly worse than the current one.
+ * score is the throughput, 0 when p99 is over -P.
+ * with -O the result is the cheapest (processes x threads, then bulk) config
+ * reaching the target, the search stops once it is reached. otherwise the
+ * result is the config with the highest score.
+ */
+static void
+run_autotune(Param& param, std::vector<char*> argv, char *envp[], MaxT& maxT)
+{
+    Config bound = {param.processes, param.threads, param.bulk};
+    int loop = param.loop;
+    double time = param.time;
+    std::unique_ptr<Session> session;
+    std::map<Config, std::pair<Point, bool>> tried; // point, full run
+    argv = strip_opts(argv, "tbnTL"); // set per config below
+    argv.push_back((char *)"-q");
+    argv.push_back((char *)"-L");
+    argv.push_back((char *)"");
+
+    auto measure = [&](const Config& c, double frac) {
+        Point pt;
+        param.processes = c.processes;
+        param.threads = c.threads;
+        param.bulk = c.bulk;
+        param.loop = std::max(1, (int)(loop * frac));
+        param.time = time * frac;
+        if (c.processes == 1) {
+            if (!session)
+                session.reset(new Session(param));
+            run(*session, param, maxT, &pt);
+        } else {
+            std::vector<char*> nargv = argv;
+            std::string t = std::to_string(c.threads);
+            std::string b = std::to_string(c.bulk);
+            std::string n = time ? std::to_string(param.time) : std::to_string(param.loop);
+            nargv.push_back((char *)"-t");
+            nargv.push_back(&t[0]);
+            nargv.push_back((char *)"-b");
+            nargv.push_back(&b[0]);
+            nargv.push_back(time ? (char *)"-T" : (char *)"-n");
+            nargv.push_back(&n[0]);
+            run_multiple_process(nargv, envp, param, &pt);
+        }
+        return pt;
+    };
+    auto score = [&](const Point& pt) {
+        return (!param.lat_bound || pt.lat[P99] <= param.lat_bound) ? pt.tput : 0;
+    };
+    auto reached = [&](const Point& pt) {
+        return param.target && score(pt) >= param.target;
+    };
+    auto eval = [&](const Config& c, double best) {
+        auto it = tried.find(c);
+        if (it != tried.end())
+            return score(it->second.first);
+        std::cout << "\nAutotune: processes " << c.processes << " / threads " << c.threads;
+        std::cout << " / cmd queue length " << c.bulk << "\n";
+        auto pt = measure(c, AUTO_PROBE);
+        if (score(pt) < best * (1 - AUTO_WORSE)) {
+            std::cout << "Autotune: dropped after probe\n";
+            tried[c] = std::make_pair(pt, false);
+            return score(pt);
+        }
+        pt = measure(c, 1);
+        tried[c] = std::make_pair(pt, true);
+        return score(pt);
+    };
+
+    Config cur = {1, 1, 1};
+    double best = eval(cur, 0);
+    bool improved = true;
+    while (improved && !reached(tried[cur].first)) {
+        improved = false;
+        for (int d = 0; d < 3 && !reached(tried[cur].first); d++) {
+            while (!reached(tried[cur].first)) {
+                Config next = cur;
+                int& v = d == 0 ? next.bulk : (d == 1 ? next.threads : next.processes);
+                int m = d == 0 ? bound.bulk : (d == 1 ? bound.threads : bound.processes);
+                if (v * 2 > m)
+                    break;
+                v *= 2;
+                double sc = eval(next, best);
+                if (sc <= best * (1 + AUTO_GAIN))
+                    break;
+                cur = next;
+                best = sc;
+                improved = true;
+            }
+        }
+    }
+
+    /* pick the result among the configs run in full */
+    const Config *res = nullptr;
+    const Point *rpt = nullptr;
+    for (auto& t : tried) {
+        auto& c = t.first;
+        auto& pt = t.second.first;
+        if (!t.second.second)
+            continue;
+        bool better;
+        if (!rpt)
+            better = true;
+        else if (param.target && reached(pt) != reached(*rpt))
+            better = reached(pt);
+        else if (param.target && reached(pt))
+            better = std::make_tuple(c.processes * c.threads, c.bulk) <
+                std::make_tuple(res->processes * res->threads, res->bulk);
+        else
+            better = score(pt) > score(*rpt);
+        if (better) {
+            res = &c;
+            rpt = &pt;
+        }
+    }
+
+    std::cout << "\nAutotune result:\n";
+    std::cout << "\tprocesses\tthreads\tqueue length\tthroughput ops/s\tp99 ms\n";
+    for (auto& t : tried) {
+        auto& c = t.first;
+        auto& pt = t.second.first;
+        std::cout << (&c == res ? "=>\t" : "\t") << c.processes << "\t\t" << c.threads << "\t";
+        std::cout << c.bulk << "\t\t" << pt.tput << "\t\t" << pt.lat[P99];
+        std::cout << (t.second.second ? "\n" : "\t(probe)\n");
+    }
+    if (param.target && !reached(*rpt))
+        std::cout << "target " << param.target << " ops/s not reached";
+    else if (param.target)
+        std::cout << "cheapest config reaching " << param.target << " ops/s";
+    else
+        std::cout << "highest throughput";
+    if (param.lat_bound)
+        std::cout << " with p99 under " << param.lat_bound << " ms";
+    std::cout << ": " << rpt->tput << " ops/s, p99 " << rpt->lat[P99] << " ms\n";
+    std::cout << "@ processes: " << res->processes << " / threads: " << res->threads;
+    std::cout << " / cmd queue length: " << res->bulk << std::endl;
+
+    param.processes = bound.processes;
+    param.threads = bound.threads;
+    param.bulk = bound.bulk;
+    param.loop = loop;
+    param.time = time;
+}
+
 static void
 check_param(const Param& param)
 {
@@ -855,15 +2804,34 @@ check_param(const Param& param)
     if (param.device_index >= xclProbe())                                      
         throw std::runtime_error("\n-d specified error");
 
-    if (param.mode < MODE_TPUT || param.mode > MODE_SINGLE_RUN)
+    if (param.mode < MODE_TPUT || param.mode > MODE_BANK)
         throw std::runtime_error("\n-m specified error");
 
+    if (param.mode == MODE_BANK && (param.run_type != RUN_TYPE_DMA || param.processes > 1))
+        throw std::runtime_error("\n-m bank supported by single process dma test only");
+
+    if (param.mode == MODE_AUTO && (param.run_type != RUN_TYPE_KERNEL || param.rate))
+        throw std::runtime_error("\n-m auto supported by kernel execution test without -R only");
+
+    if (param.target < 0)
+        throw std::runtime_error("\n-O specified error");
+
+    if (param.lat_bound < 0)
+        throw std::runtime_error("\n-P specified error");
+
+    if (param.mode == MODE_CURVE && (param.run_type != RUN_TYPE_KERNEL || param.rate))
+        throw std::runtime_error("\n-m curve supported by kernel execution test without -R only");
+
     if (param.run_type < RUN_TYPE_DMA || param.run_type > RUN_TYPE_KERNEL)
         throw std::runtime_error("\n-K specified error");
 
-    if (param.dir < 0 || (param.dir > 1 && param.dir != INT_MAX))
+    if (param.dir < 0 || (param.dir > DMA_DUPLEX && param.dir != INT_MAX))
         throw std::runtime_error("\n-D specified error");
 
+    if (param.dir == DMA_DUPLEX && (param.run_type != RUN_TYPE_DMA || param.processes > 1 ||
+        (param.mode != MODE_SINGLE_RUN && param.mode != MODE_MT)))
+        throw std::runtime_error("\n-D 2 supported by single process dma test in mode mt or 4 only");
+
     if (param.processes == 0)
         throw std::runtime_error("\n-p specified error");
 
@@ -876,10 +2844,46 @@ check_param(const Param& param)
     if (param.loop == 0)
         throw std::runtime_error("\n-n specified error");
 
-    if (param.cu_type == KERNEL_CU_ILLEGAL)
+    if (param.bo_mode <= BO_MODE_ILLEGAL || param.bo_mode > BO_MODE_ALL)
+        throw std::runtime_error("\n-B specified error");
+
+    if (param.bo_mode == BO_MODE_ALL && (param.processes > 1 || param.mode != MODE_SINGLE_RUN ||
+        param.dir == DMA_DUPLEX || param.rate))
+        throw std::runtime_error("\n-B all supported by single process mode 4 run only");
+
+    if (param.arg_update <= ARG_UPDATE_ILLEGAL || param.arg_update > ARG_UPDATE_ALL)
+        throw std::runtime_error("\n-U specified error");
+
+    if (param.arg_update != ARG_UPDATE_NONE && param.run_type != RUN_TYPE_KERNEL)
+        throw std::runtime_error("\n-U supported by kernel execution test only");
+
+    if (param.arg_update == ARG_UPDATE_ALL && (param.processes > 1 || param.mode != MODE_SINGLE_RUN ||
+        param.rate || param.bo_mode == BO_MODE_ALL))
+        throw std::runtime_error("\n-U all supported by single process mode 4 run only");
+
+    if (param.async && param.run_type != RUN_TYPE_DMA)
+        throw std::runtime_error("\n-a supported by dma test only");
+
+    if (param.rate < 0)
+        throw std::runtime_error("\n-R specified error");
+
+    if (param.rate && param.run_type != RUN_TYPE_KERNEL)
+        throw std::runtime_error("\n-R supported by kernel execution test only");
+
+    if (param.arrival < ARRIVAL_CONST || param.arrival > ARRIVAL_BURST)
+        throw std::runtime_error("\n-A specified error");
+
+    if (param.cu_type <= KERNEL_CU_ILLEGAL || param.cu_type > KERNEL_CU_AUTO)
         throw std::runtime_error("\n-c specified error");
     else if (param.cu_type == MULTI_KERNEL_WITH_ONE_CU_EACH)
         param.kname = DEF_KNAME + "_1:{" + DEF_KNAME + "_1_1}";
+    else if (param.cu_type == KERNEL_CU_AUTO) {
+        xclbin_cus = find_cus(param.xclbin_file);
+        if (xclbin_cus.empty())
+            throw std::runtime_error("\n-c auto: no cu found in the xclbin");
+        if (!find_cu(param.kname)) // the cu of a child is given by -N
+            param.kname = xclbin_cus[0].name();
+    }
 }
 
 int run(int argc, char** argv, char *envp[])
@@ -898,23 +2902,47 @@ int run(int argc, char** argv, char *envp[])
     int cu_type = ONE_KERNEL_ONE_CU;
     int interval = 0;
     double time = 0;
+    double rate = 0;
+    int arrival = ARRIVAL_CONST;
+    double target = 0;
+    double lat_bound = 0;
+    bool async = false;
+    int bo_mode = BO_MODE_DEV;
+    int arg_update = ARG_UPDATE_NONE;
     int dir = INT_MAX;
     std::string boStr = "4k";
+    bool size_given = false;
+    bool bulk_given = false;
+    bool threads_given = false;
+    bool processes_given = false;
+    std::vector<int> banks;
     std::string kname = DEF_KNAME + ":{" + DEF_KNAME + "_1}";
+    std::string shm_name;
+    std::string cpulist;
+    std::string numa;
     std::vector<char *> nargv;
     nargv.reserve(30);
     nargv.push_back(argv[0]);
     
-    while ((c = getopt(argc, argv, "b:c:d:hk:m:n:p:qs:t:D:LK:T:N:")) != -1) {
+    while ((c = getopt(argc, argv, "ab:c:d:hk:m:n:p:qs:t:A:B:C:D:I:LK:M:O:P:R:S:T:U:N:")) != -1) {
         switch (c)
         {
+        case 'a':
+            async = true;
+            nargv.push_back((char *)"-a");
+            break;
         case 'b':
             bulk = std::atoi(optarg);
+            bulk_given = true;
             nargv.push_back((char *)"-b");
             nargv.push_back(optarg);
             break;    
         case 'c':
             cu_type = get_cu_type(optarg);
+            if (cu_type == KERNEL_CU_AUTO) {
+                nargv.push_back((char *)"-c");
+                nargv.push_back(optarg);
+            }
             break;
         case 'd':
             device_index = std::atoi(optarg);
@@ -934,13 +2962,57 @@ int run(int argc, char** argv, char *envp[])
         case 'N':
             kname = optarg;
             break;
+        case 'R':
+            rate = std::atof(optarg);
+            nargv.push_back((char *)"-R");
+            nargv.push_back(optarg);
+            break;
+        case 'A':
+            arrival = get_arrival(optarg);
+            nargv.push_back((char *)"-A");
+            nargv.push_back(optarg);
+            break;
+        case 'B':
+            bo_mode = get_bo_mode(optarg);
+            nargv.push_back((char *)"-B");
+            nargv.push_back(optarg);
+            break;
+        case 'U':
+            arg_update = get_arg_update(optarg);
+            nargv.push_back((char *)"-U");
+            nargv.push_back(optarg);
+            break;
+        case 'C':
+            cpulist = optarg;
+            nargv.push_back((char *)"-C");
+            nargv.push_back(optarg);
+            break;
+        case 'M':
+            numa = optarg;
+            nargv.push_back((char *)"-M");
+            nargv.push_back(optarg);
+            break;
+        case 'O':
+            target = std::atof(optarg);
+            break;
+        case 'P':
+            lat_bound = std::atof(optarg);
+            break;
+        case 'S':
+            shm_name = optarg;
+            break;
+        case 'I':
+            child_slot = std::atoi(optarg);
+            break;
         case 's':
             boStr = optarg;
+            size_given = true;
             nargv.push_back((char *)"-s");
             nargv.push_back(optarg);
             break;
         case 't':
             threads = std::atoi(optarg);
+            threads_given = true;
             nargv.push_back((char *)"-t");
             nargv.push_back(optarg);
             break;
@@ -956,6 +3028,7 @@ int run(int argc, char** argv, char *envp[])
             break;                      
         case 'p':                       
             processes = std::atoi(optarg);
+            processes_given = true;
             break;                      
         case 'm':                       
             mode = get_mode(optarg);
@@ -985,38 +3058,118 @@ int run(int argc, char** argv, char *envp[])
     if (argc != optind) {
         interval = std::atoi(argv[optind]);
     }
+
+    if (!shm_name.empty()) {
+        child_shm.reset(new ShmResult(shm_name, 0));
+        live_count = &child_shm->slot(child_slot).live;
+    }
   
     Param param = {device_index, processes, threads, bulk, loop, time, lat,
-        quiet, xclbin_fnm, dir, boStr, mode, run_type, kname, cu_type, interval};
+        quiet, xclbin_fnm, dir, boStr, mode, run_type, kname, cu_type, interval, rate, arrival, target, lat_bound, async, bo_mode, banks, arg_update};
     check_param(param);                     
     MaxT maxT = {0};
+    if (param.cu_type == KERNEL_CU_AUTO && child_slot < 0)
+        printCus(param.xclbin_file);
+
+    if (!cpulist.empty()) {
+        placement.cpus = parse_cpulist(cpulist);
+        if (placement.cpus.empty())
+            throw std::runtime_error("\n-C specified error");
+    }
+    if (!numa.empty()) {
+        bool autonode = !strcasecmp(numa.c_str(), "auto");
+        if (!autonode && !isdigit(numa[0]))
+            throw std::runtime_error("\n-M specified error");
+        int node = autonode ? device_numa_node(device_index) : std::atoi(numa.c_str());
+        if (node < 0)
+            std::cout << "Warning: numa node of device " << device_index << " unknown, running unbound\n";
+        else
+            bind_node(node);
+    }
+    if (!placement.cpus.empty())
+        check_cpus();
+    if (!cpulist.empty() || !numa.empty())
+        printPlacement(param, cpulist);
 
     printCsvTitle(param);
     if (mode == MODE_TPUT) { /*throughput test. one 1 process is being used.*/
         std::cout << "\nThroughput test...\n";
         param.processes = 1;
+        Session session(param);
         auto t = make_p2(param.threads);
         for (int i = 1; i <= t; i *= 2) {
             param.threads = i;
             if (run_type == RUN_TYPE_KERNEL) {
                 for (int j = 1; j <= 256; j *= 2) {
                     param.bulk = j;
-                    run(param, maxT);
+                    run(session, param, maxT);
                 }
+            } else if (param.async) {
+                std::vector<Point> h2c, c2h;
+                Point pt;
+                param.latency = true;
+                regulate_dma_run_param(param);
+                for (int j = 1; j <= DEPTH_MAX; j *= 2) {
+                    param.bulk = j;
+                    param.dir = XCL_BO_SYNC_BO_TO_DEVICE;
+                    run(session, param, maxT, &pt);
+                    h2c.push_back(pt);
+                    param.dir = XCL_BO_SYNC_BO_FROM_DEVICE;
+                    run(session, param, maxT, &pt);
+                    c2h.push_back(pt);
+                }
+                showDepthResult(param, h2c, c2h);
             } else {
                 std::vector<std::string> sz = {"16m", "64m", "256m"};
                 for (auto& t : sz) {
                     param.bo_sz = t;
                     regulate_dma_run_param(param, true);
                     param.dir = XCL_BO_SYNC_BO_TO_DEVICE;
-                    run(param, maxT);
+                    run(session, param, maxT);
                     param.dir = XCL_BO_SYNC_BO_FROM_DEVICE;
-                    run(param, maxT);
+                    run(session, param, maxT);
                 }
             }
         }
         if (run_type == RUN_TYPE_KERNEL)
             showTputResult(param, maxT);
+    } else if (mode == MODE_CURVE) { /*throughput vs latency curve. one 1 process is being used.*/
+        std::cout << "\nThroughput vs latency curve test...\n";
+        param.processes = 1;
+        param.latency = true;
+        Session session(param);
+        std::vector<Point> points;
+        Point pt;
+        run(session, param, maxT, &pt);
+        double peak = pt.tput;
+        /* step up the offered load until 2 points can't follow it */
+        int saturated = 0;
+        for (int i = 1; i <= CURVE_MAX_STEPS && saturated < 2; i++) {
+            param.rate = peak * CURVE_STEP * i;
+            run(session, param, maxT, &pt);
+            points.push_back(pt);
+            if (pt.tput < param.rate * CURVE_SATURATED)
+                saturated++;
+        }
+        param.rate = 0;
+        showCurveResult(param, peak, points);
+    } else if (mode == MODE_AUTO) { /*autotune*/
+        std::cout << "\nAutotune test...\n";
+        param.latency = true;
+        param.processes = make_p2(processes_given ? param.processes : 8);
+        param.threads = make_p2(threads_given ? param.threads : 8);
+        param.bulk = make_p2(bulk_given ? param.bulk : 256);
+        std::cout << "Search up to processes: " << param.processes << (processes_given ? "" : " (default)");
+        std::cout << " / threads: " << param.threads << (threads_given ? "" : " (default)");
+        std::cout << " / cmd queue length: " << param.bulk << (bulk_given ? "" : " (default)") << "\n";
+        run_autotune(param, nargv, envp, maxT);
+    } else if (mode == MODE_BANK) { /*memory bank matrix*/
+        std::cout << "\nMemory bank test...\n";
+        Session session(param);
+        std::vector<std::string> sizes = {"64k", "1m", "16m", "64m"};
+        if (size_given)
+            sizes = {boStr};
+        run_banks(session, param, maxT, sizes);
     } else if (mode == MODE_MP) { /*multiple process test*/
         std::cout << "\nMultiple process test...\n";
         if (param.processes == 1) {
@@ -1056,19 +3209,24 @@ int run(int argc, char** argv, char *envp[])
         if (t != param.threads) {
             std::cout << "Roundup threads to " << t << "(next power of 2)\n";
         }
+        Session session(param);
+        int dir = param.dir;
         for (int i = 1; i <= t; i *= 2) {
             param.threads = i;
             if (run_type == RUN_TYPE_KERNEL) {
-                run(param, maxT);
+                run(session, param, maxT);
             } else {
                 regulate_dma_run_param(param);
+                param.dir = dir; // -D as given, for each thread count
                 if (param.dir == INT_MAX) {
                     param.dir = XCL_BO_SYNC_BO_TO_DEVICE;
-                    run(param, maxT);
+                    run(session, param, maxT);
                     param.dir = XCL_BO_SYNC_BO_FROM_DEVICE;
-                    run(param, maxT);
+                    run(session, param, maxT);
+                } else if (param.dir == DMA_DUPLEX) {
+                    run_duplex(session, param, maxT);
                 } else {
-                    run(param, maxT);
+                    run(session, param, maxT);
                 }
             }
         }
@@ -1095,17 +3253,26 @@ int run(int argc, char** argv, char *envp[])
             return 0;
         }
 
-        if (run_type == RUN_TYPE_KERNEL) {
-            run(param, maxT);
+        Session session(param);
+        if (param.bo_mode == BO_MODE_ALL) {
+            if (run_type == RUN_TYPE_DMA)
+                regulate_dma_run_param(param);
+            run_bo_modes(session, param, maxT);
+        } else if (param.arg_update == ARG_UPDATE_ALL) {
+            run_arg_updates(session, param, maxT);
+        } else if (run_type == RUN_TYPE_KERNEL) {
+            run(session, param, maxT);
         } else {
             regulate_dma_run_param(param);
             if (param.dir == INT_MAX) {
                 param.dir = XCL_BO_SYNC_BO_TO_DEVICE;
-                run(param, maxT);
+                run(session, param, maxT);
                 param.dir = XCL_BO_SYNC_BO_FROM_DEVICE;
-                run(param, maxT);
+                run(session, param, maxT);
+            } else if (param.dir == DMA_DUPLEX) {
+                run_duplex(session, param, maxT);
             } else {
-                run(param, maxT);
+                run(session, param, maxT);
             }
         }
     }
@@ -1118,6 +3285,8 @@ int main(int argc, char** argv, char *envp[])
         return run(argc, argv, envp);
     }
     catch (std::exception const& e) {
+        if (child_shm)
+            child_shm->abort();
         std::cout << "Exception: " << e.what() << "\n";
         std::cout << "Test failed(pid: " << getpid() <<")!!\n";
         return 1;
@@ -24,19 +24,29 @@
 #include <spawn.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <cstdlib>
 #include <cmath>
 #include <ctime>
 #include <time.h>
 #include <chrono>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <random>
+#include <tuple>
 #include <future>
+#include <functional>
+#include <memory>
 #include <boost/algorithm/string.hpp>
 #include "boost/filesystem.hpp"
 
 #include "experimental/xrt_device.h"
 #include "experimental/xrt_kernel.h"
 #include "experimental/xrt_bo.h"
+#include "xclbin.h"
 
 std::mutex print_mutex;
 const std::string csv_history_file = "tput_history.csv";
@@ -45,6 +55,11 @@ const std::string EXT = "xxxxoooo";
 const std::string TMP = "tmpxxxxoooo/";
 #define DEFAULT_COUNT (30000)
 #define DEFAULT_BULK (32)
+#define BALANCE_SKEW (4)        // runs of a balancer target, in multiple of -b
+#define BALANCE_TIMEOUT (10)    // s without a completion the balancer gives up
+#define HIST_SUB_BITS (7)
+#define HIST_MAX_BITS (40)
+#define HIST_BUCKETS ((HIST_MAX_BITS - HIST_SUB_BITS + 2) << (HIST_SUB_BITS - 1))
 const std::string DEF_KNAME = "hello";
 
 enum kernel_cu {
@@ -58,6 +73,8 @@ enum kernel_run_type {
     RUN_TYPE_ILLEGAL = 0,
     RUN_TYPE_DMA = 1,
     RUN_TYPE_KERNEL = 2,
+    RUN_TYPE_COPY = 3,
+    RUN_TYPE_BRINGUP = 4,
 };
 
 enum run_mode {
@@ -86,6 +103,22 @@ struct Param {
     int run_type;
     std::string& kname;
     int cu_type;
+    std::string pair;   // copy test, "src_dev:bank-dst_dev:bank"
+};
+
+/*
+ * one end of a copy, dev is the position in the -d list, bank the memory group,
+ * -1 for the group of arg 0 of the kernel
+ */
+struct Endpoint {
+    size_t dev;
+    int bank;
+};
+
+struct CopyPair {
+    Endpoint src;
+    Endpoint dst;
+    std::string name;
 };
 
 struct Count {
@@ -123,6 +156,61 @@ public:
     }
 };
 
+/*
+ * helper threads doing the copies of the async copy cmds of one thread, one helper
+ * per cmd, started before the test so no thread is created while copying.
+ */
+class CopyPool {
+public:
+    CopyPool(size_t n)
+    {
+        for (size_t i = 0; i < n; i++)
+            workers.emplace_back(&CopyPool::work, this);
+    }
+
+    ~CopyPool()
+    {
+        {
+            std::lock_guard<std::mutex> lk(m);
+            stop = true;
+        }
+        cv.notify_all();
+        for (auto& w : workers)
+            w.join();
+    }
+
+    std::future<void> submit(std::function<void()> job)
+    {
+        auto task = std::make_shared<std::packaged_task<void()>>(std::move(job));
+        auto f = task->get_future();
+        std::lock_guard<std::mutex> lk(m);
+        jobs.push_back([task] { (*task)(); });
+        cv.notify_one();
+        return f;
+    }
+
+private:
+    std::mutex m;
+    std::condition_variable cv;
+    std::deque<std::function<void()>> jobs;
+    std::vector<std::thread> workers;
+    bool stop = false;
+
+    void work()
+    {
+        while (true) {
+            std::unique_lock<std::mutex> lk(m);
+            cv.wait(lk, [this] { return stop || !jobs.empty(); });
+            if (jobs.empty())
+                return;
+            auto job = std::move(jobs.front());
+            jobs.pop_front();
+            lk.unlock();
+            job();
+        }
+    }
+};
+
 class Cmd {
 public:    
     Cmd(const xrtDeviceHandle& device, const xrt::kernel& kernel, std::string& szStr,
@@ -135,9 +223,22 @@ public:
         bo_size = sz;
     }
 
+    /*
+     * copy test, src to dst with xrt::bo::copy, each cmd with its own bos.
+     * without a pool (1 cmd per thread) the copy is done inline, otherwise each copy
+     * runs on a helper of the pool so the cmds are in flight at once
+     */
+    Cmd(xrt::bo& src, xrt::bo& dst, size_t sz, bool latency, CopyPool *pool) :
+       lat(latency), bosync((xclBOSyncDirection)INT_MAX), bo(dst), bo_size(sz), src(src),
+       copy(true), pool(pool)
+    {
+    }
+
     void run()
     {
-        if (is_dma_test())
+        if (copy)
+            run_copy_test();
+        else if (is_dma_test())
             run_dma_test();
         else
             run_kernel_test();
@@ -145,7 +246,9 @@ public:
 
     bool done()
     {
-        if (is_dma_test())
+        if (copy)
+            return copy_done();
+        else if (is_dma_test())
             return true;
         else
             return kernel_done();
@@ -153,8 +256,12 @@ public:
 
     void wait()
     {
-        if (!is_dma_test())
+        if (copy) {
+            if (pending.valid())
+                pending.get();
+        } else if (!is_dma_test()) {
             kernel_wait();
+        }
     }
 
     Count count = {LLONG_MAX, LLONG_MIN, 0, 0};
@@ -170,6 +277,11 @@ private:
     void *hptr;
     size_t bo_size;
 
+    xrt::bo src;
+    bool copy = false;
+    CopyPool *pool = nullptr;
+    std::future<void> pending;
+
     bool is_dma_test()
     {
         return (bosync == XCL_BO_SYNC_BO_TO_DEVICE || bosync == XCL_BO_SYNC_BO_FROM_DEVICE);
@@ -187,6 +299,41 @@ private:
         }
     }
 
+    void run_copy_test()
+    {
+        if (lat)
+            stamp = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+        if (!pool) {
+            bo.copy(src, bo_size);
+            copy_complete();
+            return;
+        }
+        pending = pool->submit([this] { bo.copy(src, bo_size); });
+    }
+
+    bool copy_done()
+    {
+        if (!pool)
+            return true;
+        /* not reissued after the last completion */
+        if (!pending.valid())
+            return false;
+        if (pending.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready)
+            return false;
+        pending.get();
+        copy_complete();
+        return true;
+    }
+
+    void copy_complete()
+    {
+        if (lat) {
+            auto end = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+            update_lat(end);
+        }
+        count.count++;
+    }
+
     void run_kernel_test()
     {
         if (cmd)
@@ -287,6 +434,30 @@ void usage(char* exename)
     std::cout << "\t-K <run type> optional, default is 2\n";
     std::cout << "\t           1|dma: dma test\n";
     std::cout << "\t           2|kernel: kernel execution test\n";
+    std::cout << "\t           3|copy: bo copy test between the devices of -d, in 1 process,\n";
+    std::cout << "\t                   with bo size 4k, 64k, 1m, 16m, 64m or the one of -s\n";
+    std::cout << "\t           4|bringup: time of device open, xclbin load, kernel creation and allocating\n";
+    std::cout << "\t                   the -t x -b bo pool, and of closing it all, per device, with the devices\n";
+    std::cout << "\t                   of -d one after the other and then in parallel, -r rounds each. the\n";
+    std::cout << "\t                   first round is the cold one, the rounds after reload the same xclbin\n";
+    std::cout << "\t-r <rounds>, rounds of the bringup test, optional, default is 3\n";
+    std::cout << "\t-O <order>, serial|parallel, which bring-up of the bringup test runs first and so has\n";
+    std::cout << "\t           the cold round, optional, default is serial\n";
+    std::cout << "\t-P <pairs> copy pairs of copy test, optional, separated by \",\"\n";
+    std::cout << "\t           src-dst, each is <device>[:<bank>], device is the position in the -d list,\n";
+    std::cout << "\t           bank is the memory group, default is the one of arg 0 of the kernel\n";
+    std::cout << "\t           eg. 0-0: same bank, 0:0-0:1: cross bank, 0-1: cross device (p2p)\n";
+    std::cout << "\t           default is 0-0, and 0-1 when there are 2 devices or more\n";
+    std::cout << "\t-S, single process, all the devices of -d are opened in this process and driven by\n";
+    std::cout << "\t           -t threads per device, started together, reported per device and combined\n";
+    std::cout << "\t-B <policy>, load balance, one stream of kernel cmds spread over the cus of all the devices\n";
+    std::cout << "\t           of -d, in 1 process, -b cmds per cu in flight in total, -n cmds in total\n";
+    std::cout << "\t           1|rr: round robin\n";
+    std::cout << "\t           2|lo: least outstanding cmds\n";
+    std::cout << "\t           3|p2c: power of two choices, the less loaded of 2 random cus\n";
+    std::cout << "\t           4|all: run with each of them, reporting throughput, p99 latency and spread\n";
+    std::cout << "\t-c <cus>, most cus per device used by -B, of the kernel of -N, as found in the xclbin\n";
+    std::cout << "\t           of each device, optional, default is all of them\n";
     std::cout << "\t-N <kernel/cu name> optional,\n";
     std::cout << "\t            default for one cu per kernel is \"hello:{hello_1}\"\n";
     std::cout << "\t            default for multiple cu per kernel is \"hello_1:{hello_1_1}\"\n";
@@ -328,6 +499,10 @@ static void printCsvTitle(const Param& param)
     }
     if (param.run_type == RUN_TYPE_DMA) {
         line += "DMA\n";
+    } else if (param.run_type == RUN_TYPE_COPY) {
+        line += "copy\n";
+    } else if (param.run_type == RUN_TYPE_BRINGUP) {
+        line += "bringup\n";
     } else { 
         line += "kernel_execution\n";
     }
@@ -375,6 +550,9 @@ static void printResult(const Param& param, const Timer& timer, const std::vecto
         } else if (param.dir == XCL_BO_SYNC_BO_FROM_DEVICE) {
             std::cout << "\nDMA FPGA write ";
             line += "\"direction\": \"c2h\", ";
+        } else if (param.run_type == RUN_TYPE_COPY) {
+            std::cout << "\nbo copy ";
+            line += "\"direction\": \"copy\", ";
         } else {
             std::cout << "\nkernel execution ";
         }
@@ -383,17 +561,26 @@ static void printResult(const Param& param, const Timer& timer, const std::vecto
         } else {
             std::cout << "latency:\n";
         }
-        std::cout <<  "\tdevice index: " << param.device_index << std::endl;
-        line += "\"device_index\": " + std::to_string(param.device_index) + ", ";
+        if (param.run_type == RUN_TYPE_COPY) {
+            std::cout <<  "\tcopy pair: " << param.pair << std::endl;
+            line += "\"pair\": \"" + param.pair + "\", ";
+        } else {
+            std::cout <<  "\tdevice index: " << param.device_index << std::endl;
+            line += "\"device_index\": " + std::to_string(param.device_index) + ", ";
+        }
         std::cout <<  "\tprocess(es): " << param.processes << std::endl;
         line += "\"process\": " + std::to_string(param.processes) + ", ";
         std::cout <<  "\tthread(s) per process: " << param.threads << std::endl;
         line += "\"thread\": " + std::to_string(param.threads) + ", ";
         if (!param.latency) {
             if (param.dir == XCL_BO_SYNC_BO_TO_DEVICE ||
-                param.dir == XCL_BO_SYNC_BO_FROM_DEVICE) {
+                param.dir == XCL_BO_SYNC_BO_FROM_DEVICE || param.run_type == RUN_TYPE_COPY) {
                 std::cout << "\tbo size: " << param.bo_sz << std::endl;
                 line += "\"bo_size\": \"" + param.bo_sz + "\", ";
+                if (param.run_type == RUN_TYPE_COPY) {
+                    std::cout << "\tqueue length: " << param.bulk << std::endl;
+                    line += "\"queue_length\": " + std::to_string(param.bulk) + ", ";
+                }
                 std::cout << "\tbandwidth: ";
                 line += "\"bandwidth_MB_per_sec\": ";
                 std::cout << res.count * get_value(param.bo_sz) / timer.elapsed() / 1000 << " MB/s (";
@@ -410,10 +597,11 @@ static void printResult(const Param& param, const Timer& timer, const std::vecto
             }
         } else {
             if (param.dir == XCL_BO_SYNC_BO_TO_DEVICE ||
-                param.dir == XCL_BO_SYNC_BO_FROM_DEVICE) {
+                param.dir == XCL_BO_SYNC_BO_FROM_DEVICE || param.run_type == RUN_TYPE_COPY) {
                 std::cout << "\tbo size: " << param.bo_sz << std::endl;
                 line += "\"bo_size\": \"" + param.bo_sz + "\", ";
-            } else {
+            }
+            if (param.dir == INT_MAX) {
                 std::cout << "\tqueue length: " << param.bulk << std::endl;
                 line += "\"queue_length\": " + std::to_string(param.bulk) + ", ";
             }
@@ -624,6 +812,10 @@ static int get_run_type(const char* str)
         return RUN_TYPE_DMA;
     if (!strcasecmp(str, "kernel"))
         return RUN_TYPE_KERNEL;
+    if (!strcasecmp(str, "copy"))
+        return RUN_TYPE_COPY;
+    if (!strcasecmp(str, "bringup"))
+        return RUN_TYPE_BRINGUP;
     return std::atoi(str);
 }
 
@@ -795,7 +987,7 @@ check_param(const Param& param)
     if (param.mode < MODE_TPUT || param.mode > MODE_SINGLE_RUN)
         throw std::runtime_error("\n-m specified error");
 
-    if (param.run_type < RUN_TYPE_DMA || param.run_type > RUN_TYPE_KERNEL)
+    if (param.run_type < RUN_TYPE_DMA || param.run_type > RUN_TYPE_BRINGUP)
         throw std::runtime_error("\n-K specified error");
 
     if (param.dir < 0 || (param.dir > 1 && param.dir != INT_MAX))
@@ -830,6 +1022,751 @@ split(const std::string& input, std::vector<std::string>& output)
     output.push_back(input.substr(last));
 }
 
+static Endpoint
+parse_endpoint(const std::string& str, size_t devices)
+{
+    auto pos = str.find(":");
+    Endpoint ep = {(size_t)std::atoi(str.substr(0, pos).c_str()), -1};
+    if (pos != std::string::npos)
+        ep.bank = std::atoi(str.substr(pos + 1).c_str());
+    if (str.empty() || !isdigit(str[0]) || ep.dev >= devices)
+        throw std::runtime_error("\n-P specified error");
+    return ep;
+}
+
+static void
+parse_pairs(const std::string& input, size_t devices, std::vector<CopyPair>& pairs)
+{
+    std::vector<std::string> list;
+    split(input, list);
+    for (auto& p : list) {
+        auto pos = p.find("-");
+        if (pos == std::string::npos)
+            throw std::runtime_error("\n-P specified error");
+        pairs.push_back({parse_endpoint(p.substr(0, pos), devices),
+            parse_endpoint(p.substr(pos + 1), devices), p});
+    }
+}
+
+/*
+ * copy test of one pair. each cmd copies between its own src and dst bos, so -b
+ * copies in flight are on different buffers. the dst bo of a cross device pair is a
+ * p2p bo, so p2p has to be enabled on the card. it is exported and imported to the
+ * src device, where the copy runs with both bos.
+ */
+static int run_copy(const Param& param, std::vector<xrt::device>& devices,
+    const std::vector<int>& grps, const CopyPair& pair, MaxT& maxT)
+{
+    auto sz = get_value(param.bo_sz);
+    int bulk = std::min(param.bulk, param.loop);
+    int sgrp = pair.src.bank < 0 ? grps[pair.src.dev] : pair.src.bank;
+    int dgrp = pair.dst.bank < 0 ? grps[pair.dst.dev] : pair.dst.bank;
+    bool p2p = pair.src.dev != pair.dst.dev;
+    std::vector<std::thread> thrs;
+    int c;
+    std::cout << "Test running...(pid: " << getpid() << ", copy " << pair.name << ")\n";
+
+    std::vector<xrt::bo> bos;   // p2p bos exported to the src device
+    std::vector<std::unique_ptr<CopyPool>> pools;
+    std::vector<std::vector<Cmd>> cmds;
+    for (c = 0; c < param.threads; c++) {
+        pools.emplace_back(bulk > 1 ? new CopyPool(bulk) : nullptr);
+    	std::vector<Cmd> cmdlist;
+    	for (int i = 0; i < bulk; i++) {
+            xrt::bo src(devices[pair.src.dev], sz, 0, sgrp);
+            xrt::bo dst(devices[pair.dst.dev], sz, p2p ? XCL_BO_FLAGS_P2P : 0, dgrp);
+            if (p2p) {
+                bos.push_back(dst);
+                dst = xrt::bo(devices[pair.src.dev], bos.back().export_buffer());
+            }
+        	cmdlist.emplace_back(src, dst, sz, param.latency, pools.back().get());
+        }
+       	cmds.push_back(std::move(cmdlist));
+    }
+
+    Timer timer(param.time);
+    if (param.threads == 1) {
+        thr0(cmds[0], param.time ? 0 : param.loop, timer);
+    } else {
+        for (c = 0; c < param.threads; c++)
+            thrs.emplace_back(&thr0, std::ref(cmds[c]), param.time ? 0 : param.loop, std::ref(timer));
+        for (auto& t : thrs)
+            t.join();
+    }
+    timer.stop();
+
+    printResult(param, timer, cmds, maxT);
+    return 0;
+}
+
+/*
+ * a device of the single process run (-S), opened with its xclbin loaded, and the
+ * cmd queues of its -t worker threads
+ */
+struct Card {
+    std::string index;
+    xrt::device device;
+    xrt::uuid uuid;
+    xrt::kernel krnl;
+    std::vector<std::string> cus;   // cus of the -N kernel in the xclbin, -B only
+    std::vector<std::vector<Cmd>> cmds;
+    std::vector<long> ends;     // time stamp of each worker thread finishing
+};
+
+static void
+open_cards(const Param& param, const std::vector<std::string>& fxclbin,
+    const std::vector<std::string>& indexs, std::vector<Card>& cards)
+{
+    if (fxclbin.size() != indexs.size())
+        throw std::runtime_error("\n-k and -d specified different number of devices");
+    for (size_t i = 0; i < indexs.size(); i++) {
+        Card card;
+        card.index = indexs[i];
+        card.device = xrt::device(std::atoi(indexs[i].c_str()));
+        Timer timer_ld;
+        card.uuid = card.device.load_xclbin(fxclbin[i]);
+        timer_ld.stop();
+        card.krnl = xrt::kernel(card.device, card.uuid.get(), param.kname, false);
+        std::cout << "device " << card.index << ": xclbin loaded in " << timer_ld.elapsed() << " ms\n";
+        cards.push_back(std::move(card));
+    }
+}
+
+static void
+mergeCount(Count& res, const Count& c)
+{
+    if (!c.count)
+        return;
+    res.min = std::min(res.min, c.min);
+    res.max = std::max(res.max, c.max);
+    res.avg = (res.avg * res.count + c.avg * c.count) / (res.count + c.count);
+    res.count += c.count;
+}
+
+/*
+ * one line of the single process result, a device or the total of all of them.
+ * kernel execution in ops/s, dma in MB/s and transfers/s
+ */
+static void
+printCardLine(const Param& param, const std::string& name, const Count& res, double ms, std::ofstream& handle)
+{
+    bool dma = param.dir == XCL_BO_SYNC_BO_TO_DEVICE || param.dir == XCL_BO_SYNC_BO_FROM_DEVICE;
+    std::string line = "{";
+    if (dma)
+        line += std::string("\"direction\": \"") + (param.dir == XCL_BO_SYNC_BO_TO_DEVICE ? "h2c" : "c2h") + "\", ";
+    line += "\"device_index\": \"" + name + "\", ";
+    line += "\"thread\": " + std::to_string(param.threads) + ", ";
+    line += "\"queue_length\": " + std::to_string(param.bulk) + ", ";
+    line += "\"bo_size\": \"" + param.bo_sz + "\", ";
+    std::cout << "\tdevice " << name << ": ";
+    if (!param.latency) {
+        if (dma) {
+            std::cout << res.count * get_value(param.bo_sz) / ms / 1000 << " MB/s, ";
+            line += "\"bandwidth_MB_per_sec\": " + std::to_string(res.count * get_value(param.bo_sz) / ms / 1000) + ", ";
+        }
+        std::cout << res.count / ms * 1000 << " ops/s (" << res.count;
+        std::cout << (dma ? " transfers in " : " executions in ") << ms << " ms)\n";
+        line += "\"throughput_op_per_sec\": " + std::to_string(res.count / ms * 1000);
+    } else {
+        std::cout << "count: " << res.count << ", min: " << (double)res.min / 1000000;
+        std::cout << " ms, max: " << (double)res.max / 1000000 << " ms, avg: ";
+        std::cout << (double)res.avg / 1000000 << " ms\n";
+        line += "\"count\": " + std::to_string(res.count) + ", ";
+        line += "\"min_ms\": " + std::to_string((double)res.min / 1000000) + ", ";
+        line += "\"max_ms\": " + std::to_string((double)res.max / 1000000) + ", ";
+        line += "\"avg_ms\": " + std::to_string((double)res.avg / 1000000);
+    }
+    handle << line + "}\n";
+}
+
+/*
+ * with -n a device is timed to its last thread finishing, with -T all the devices
+ * count over the same period. the total is over the whole run.
+ */
+static void
+printCardsResult(const Param& param, const Timer& timer, const std::vector<Card>& cards)
+{
+    std::ofstream handle(qor_csv_file, std::ofstream::app);
+    if (param.dir == XCL_BO_SYNC_BO_TO_DEVICE)
+        std::cout << "\nDMA FPGA read ";
+    else if (param.dir == XCL_BO_SYNC_BO_FROM_DEVICE)
+        std::cout << "\nDMA FPGA write ";
+    else
+        std::cout << "\nkernel execution ";
+    std::cout << (param.latency ? "latency" : "throughput") << " (1 process, " << cards.size() << " devices):\n";
+    std::cout << "\tthread(s) per device: " << param.threads << std::endl;
+    std::cout << "\tqueue length: " << param.bulk << std::endl;
+    std::cout << "\tbo size: " << param.bo_sz << std::endl;
+
+    Count total = {LLONG_MAX, LLONG_MIN, 0, 0};
+    for (auto& card : cards) {
+        Count res = {LLONG_MAX, LLONG_MIN, 0, 0};
+        for (auto& t : card.cmds) {
+            size_t c = 0;
+            for (auto& t1 : t) {
+                c += t1.count.count;
+                mergeCount(res, t1.count);
+            }
+            if (!param.time && c != (size_t)param.loop)
+                throw std::runtime_error("per thread count calculation error");
+        }
+        double ms = timer.elapsed();
+        if (!param.time)
+            ms = (*std::max_element(card.ends.begin(), card.ends.end()) -
+                timer.start.time_since_epoch().count()) / 1000000.0;
+        printCardLine(param, card.index, res, ms, handle);
+        mergeCount(total, res);
+    }
+    printCardLine(param, "all", total, timer.elapsed(), handle);
+    handle.close();
+}
+
+/*
+ * all the devices driven from this process, -t worker threads per device. the threads
+ * wait until all of them are set up, then start together on the same timer.
+ */
+static int run_cards(const Param& param, std::vector<Card>& cards)
+{
+    int bulk = std::min(param.bulk, param.loop);
+    std::cout << "Test running...(pid: " << getpid() << ", " << cards.size() << " devices)\n";
+    for (auto& card : cards) {
+        card.cmds.clear();
+        card.ends.assign(param.threads, 0);
+        for (int c = 0; c < param.threads; c++) {
+            std::vector<Cmd> cmdlist;
+            for (int i = 0; i < bulk; i++)
+                cmdlist.emplace_back(card.device, card.krnl, param.bo_sz, param.latency, param.dir);
+            card.cmds.push_back(std::move(cmdlist));
+        }
+    }
+
+    Timer timer(param.time);
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> thrs;
+    for (auto& card : cards) {
+        for (int c = 0; c < param.threads; c++) {
+            thrs.emplace_back([&, c] {
+                ready++;
+                while (!go)
+                    std::this_thread::yield();
+                thr0(card.cmds[c], param.time ? 0 : param.loop, timer);
+                card.ends[c] = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+            });
+        }
+    }
+    while (ready < (int)thrs.size())
+        std::this_thread::yield();
+    timer.start = std::chrono::high_resolution_clock::now();
+    go = true;
+    for (auto& t : thrs)
+        t.join();
+    timer.stop();
+
+    printCardsResult(param, timer, cards);
+    return 0;
+}
+
+enum balance_policy {
+    POLICY_ILLEGAL = 0,
+    POLICY_RR = 1,
+    POLICY_LO = 2,
+    POLICY_P2C = 3,
+    POLICY_ALL = 4,
+};
+
+static const char *policy_name(int policy)
+{
+    const char *name[] = {"illegal", "rr", "lo", "p2c", "all"};
+    return name[policy];
+}
+
+static int get_policy(const char* str)
+{
+    for (int p = POLICY_RR; p <= POLICY_ALL; p++) {
+        if (!strcasecmp(str, policy_name(p)))
+            return p;
+    }
+    return std::atoi(str);
+}
+
+/*
+ * latency histogram in ns, HDR style as in host.cpp. values below 2^HIST_SUB_BITS
+ * have their own bucket, above that each power of 2 range is split into
+ * 2^(HIST_SUB_BITS-1) linear buckets, values beyond 2^HIST_MAX_BITS ns go to the last.
+ * fixed size, however long the run is.
+ */
+struct Hist {
+    size_t count = 0;
+    long min = LLONG_MAX;
+    long max = LLONG_MIN;
+    uint64_t bucket[HIST_BUCKETS] = {0};
+
+    static int index(long v)
+    {
+        if (v < (1L << HIST_SUB_BITS))
+            return v < 0 ? 0 : v;
+        if (v >= (1L << HIST_MAX_BITS))
+            v = (1L << HIST_MAX_BITS) - 1;
+        int e = 63 - __builtin_clzl(v) - HIST_SUB_BITS + 1;
+        return (e << (HIST_SUB_BITS - 1)) + (v >> e);
+    }
+
+    /* highest value falls in the bucket */
+    static long value(int idx)
+    {
+        if (idx < (1 << HIST_SUB_BITS))
+            return idx;
+        int e = (idx >> (HIST_SUB_BITS - 1)) - 1;
+        long sub = idx - (e << (HIST_SUB_BITS - 1));
+        return ((sub + 1) << e) - 1;
+    }
+
+    void record(long v)
+    {
+        bucket[index(v)]++;
+        count++;
+        min = std::min(min, v);
+        max = std::max(max, v);
+    }
+
+    void merge(const Hist& h)
+    {
+        for (int i = 0; i < HIST_BUCKETS; i++)
+            bucket[i] += h.bucket[i];
+        count += h.count;
+        min = std::min(min, h.min);
+        max = std::max(max, h.max);
+    }
+
+    long percentile(double p) const
+    {
+        size_t target = std::ceil(p / 100 * count);
+        size_t c = 0;
+        if (!count)
+            return 0;
+        if (!target)
+            target = 1;
+        for (int i = 0; i < HIST_BUCKETS; i++) {
+            c += bucket[i];
+            if (c >= target)
+                return std::max(min, std::min(max, value(i)));
+        }
+        return max;
+    }
+};
+
+/*
+ * a cu of a device the balancer sends cmds to. each target has a pool of idle runs
+ * of BALANCE_SKEW times its share of the window, so a policy can skew the load
+ * that much, while the runs and bos grow with the number of targets only.
+ */
+struct Target {
+    std::string name;
+    std::vector<xrt::bo> bos;
+    std::vector<xrt::run> runs;
+    std::vector<long> stamps;
+    std::vector<int> idle;
+    int outstanding = 0;
+    Hist hist;
+};
+
+/* completions of all the targets, pushed by the xrt run callbacks */
+class CompletionQueue {
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<std::tuple<int, int, long>> q;  // target, run, end
+public:
+    void push(int t, int r, long end) {
+        std::lock_guard<std::mutex> lock(mtx);
+        q.emplace_back(t, r, end);
+        cv.notify_one();
+    }
+    bool pop(int& t, int& r, long& end) {
+        std::unique_lock<std::mutex> lock(mtx);
+        if (!cv.wait_for(lock, std::chrono::milliseconds(1000), [this] { return !q.empty(); }))
+            return false;
+        std::tie(t, r, end) = q.front();
+        q.pop_front();
+        return true;
+    }
+};
+
+struct PolicyResult {
+    int policy;
+    double tput;
+    double p99;
+    double jain;
+};
+
+static size_t pick_policy(int policy, const std::vector<Target>& targets, size_t& next, std::mt19937& rng)
+{
+    size_t n = targets.size();
+    size_t t = next;
+    if (policy == POLICY_RR) {
+        next = (next + 1) % n;
+    } else if (policy == POLICY_LO) {
+        /* scan from the rr position, so ties don't always go to the first target */
+        for (size_t i = 1; i < n; i++) {
+            size_t j = (next + i) % n;
+            if (targets[j].outstanding < targets[t].outstanding)
+                t = j;
+        }
+        next = (next + 1) % n;
+    } else {
+        std::uniform_int_distribution<size_t> dist(0, n - 1);
+        t = dist(rng);
+        size_t u = n > 1 ? (t + 1 + dist(rng) % (n - 1)) % n : t;
+        if (targets[u].outstanding < targets[t].outstanding)
+            t = u;
+    }
+    return t;
+}
+
+/*
+ * the target picked by the policy, or if it has no idle run, the least loaded one
+ * with an idle run. there is always one while the window is not full.
+ */
+static size_t pick_target(int policy, const std::vector<Target>& targets, size_t& next, std::mt19937& rng)
+{
+    size_t t = pick_policy(policy, targets, next, rng);
+    if (!targets[t].idle.empty())
+        return t;
+    for (size_t j = 0; j < targets.size(); j++) {
+        if (!targets[j].idle.empty() && (targets[t].idle.empty() || targets[j].outstanding < targets[t].outstanding))
+            t = j;
+    }
+    return t;
+}
+
+/* the whole xclbin file, checked to be a xclbin */
+static std::vector<char> read_xclbin(const std::string& xclbin)
+{
+    std::ifstream f(xclbin, std::ios::binary);
+    std::vector<char> buf((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    auto top = reinterpret_cast<const axlf *>(buf.data());
+    if (buf.size() < sizeof(axlf) || strncmp(top->m_magic, "xclbin2", 8))
+        throw std::runtime_error("\n" + xclbin + " is not a xclbin");
+    return buf;
+}
+
+/*
+ * the cus of the kernel in the IP_LAYOUT section of the xclbin, named kernel:{cu},
+ * at most max of them, all with max 0. section headers or sections beyond the end
+ * of the file are ignored.
+ */
+static std::vector<std::string> kernel_cus(const std::string& xclbin, const std::string& kernel, int max)
+{
+    std::vector<std::string> cus;
+    auto buf = read_xclbin(xclbin);
+    auto top = reinterpret_cast<const axlf *>(buf.data());
+    for (uint32_t i = 0; i < top->m_header.m_numSections; i++) {
+        if (offsetof(axlf, m_sections) + (i + 1) * sizeof(axlf_section_header) > buf.size())
+            break;
+        auto& sec = top->m_sections[i];
+        if (sec.m_sectionKind != IP_LAYOUT || sec.m_sectionOffset > buf.size() ||
+            sec.m_sectionSize > buf.size() - sec.m_sectionOffset)
+            continue;
+        auto layout = reinterpret_cast<const ip_layout *>(buf.data() + sec.m_sectionOffset);
+        auto size = sec.m_sectionSize;
+        auto head = offsetof(ip_layout, m_ip_data);
+        if (size < head || layout->m_count < 0 || (size - head) / sizeof(ip_data) < (uint64_t)layout->m_count)
+            throw std::runtime_error("\n" + xclbin + ": IP_LAYOUT section truncated or corrupt");
+        for (int j = 0; j < layout->m_count; j++) {
+            auto& ip = layout->m_ip_data[j];
+            std::string name((const char *)ip.m_name, strnlen((const char *)ip.m_name, 64));
+            auto pos = name.find(":");
+            if (ip.m_type != IP_KERNEL || name.substr(0, pos) != kernel || pos == std::string::npos)
+                continue;
+            if (!max || (int)cus.size() < max)
+                cus.push_back(kernel + ":{" + name.substr(pos + 1) + "}");
+        }
+    }
+    return cus;
+}
+
+/*
+ * one logical stream of kernel cmds spread over the cus of all the devices, up to
+ * -b cmds per target in flight in total. a single dispatcher thread picks the target
+ * of each cmd with the policy, and retires the completions of all the targets.
+ * the cus of a device are those of its own xclbin, so in a mixed fleet a device
+ * with more cus gets more targets.
+ */
+static PolicyResult
+run_balance(const Param& param, std::vector<Card>& cards, int policy)
+{
+    auto sz = get_value(param.bo_sz);
+    CompletionQueue queue;
+    std::vector<Target> targets;
+    size_t cus = 0;
+    for (auto& card : cards)
+        cus += card.cus.size();
+    size_t window = param.bulk * cus;
+    size_t depth = std::min(window, (size_t)param.bulk * BALANCE_SKEW);
+    for (auto& card : cards) {
+        for (auto& kname : card.cus) {
+            auto krnl = xrt::kernel(card.device, card.uuid.get(), kname, false);
+            int t = targets.size();
+            targets.emplace_back();
+            auto& tg = targets.back();
+            tg.name = card.index + ":" + kname;
+            tg.stamps.resize(depth);
+            for (size_t r = 0; r < depth; r++) {
+                tg.bos.emplace_back(card.device, sz, 0, krnl.group_id(0));
+                xrt::run run(krnl);
+                run.set_arg(0, tg.bos.back());
+                auto q = &queue;
+                run.add_callback(ERT_CMD_STATE_COMPLETED,
+                    [q, t, r](const void *, ert_cmd_state, void *) {
+                        q->push(t, r, std::chrono::high_resolution_clock::now().time_since_epoch().count());
+                    }, nullptr);
+                tg.runs.push_back(std::move(run));
+                tg.idle.push_back(r);
+            }
+        }
+    }
+
+    std::mt19937 rng(1);
+    size_t next = 0;
+    long total = param.time ? LONG_MAX : param.loop;
+    long issued = 0, completed = 0;
+    size_t outstanding = 0;
+    int t, r;
+    long end;
+    int waits = 0;
+    Timer timer(param.time);
+    while (completed < total) {
+        if (total == LONG_MAX && timer.expire())
+            total = issued;
+        while (outstanding < window && issued < total) {
+            auto& tg = targets[pick_target(policy, targets, next, rng)];
+            int idx = tg.idle.back();
+            tg.idle.pop_back();
+            tg.outstanding++;
+            outstanding++;
+            issued++;
+            tg.stamps[idx] = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+            tg.runs[idx].start();
+        }
+        if (completed >= total)
+            continue;
+        if (!queue.pop(t, r, end)) {
+            /* the callbacks still refer to the queue, so no unwinding */
+            if (++waits >= BALANCE_TIMEOUT) {
+                std::cout << outstanding << " cmd(s) not complete in " << BALANCE_TIMEOUT << "s\n";
+                std::cout << "Test failed(pid: " << getpid() << ")!!" << std::endl;
+                std::_Exit(EXIT_FAILURE);
+            }
+            continue;
+        }
+        waits = 0;
+        auto& tg = targets[t];
+        tg.hist.record(end - tg.stamps[r]);
+        tg.idle.push_back(r);
+        tg.outstanding--;
+        outstanding--;
+        completed++;
+    }
+    timer.stop();
+
+    std::ofstream handle(qor_csv_file, std::ofstream::app);
+    Hist all;
+    double sum = 0, sq = 0;
+    size_t most = 0, least = SIZE_MAX;
+    for (auto& tg : targets) {
+        all.merge(tg.hist);
+        sum += tg.hist.count;
+        sq += (double)tg.hist.count * tg.hist.count;
+        most = std::max(most, tg.hist.count);
+        least = std::min(least, tg.hist.count);
+    }
+    PolicyResult res = {policy, completed / timer.elapsed() * 1000,
+        (double)all.percentile(99) / 1000000, sq ? sum * sum / (targets.size() * sq) : 1};
+    std::cout << "\nload balance, policy " << policy_name(policy) << " (" << cards.size() << " devices, ";
+    std::cout << targets.size() << " cus):\n";
+    std::cout << "\tqueue length: " << param.bulk << " per cu, " << window << " in total, up to ";
+    std::cout << depth << " on a cu\n";
+    std::cout << "\tthroughput: " << res.tput << " ops/s (" << completed << " executions in ";
+    std::cout << timer.elapsed() << " ms)\n";
+    std::cout << "\tlatency p50: " << (double)all.percentile(50) / 1000000 << " ms, p99: " << res.p99;
+    std::cout << " ms, p99.9: " << (double)all.percentile(99.9) / 1000000 << " ms\n";
+    std::string line = "{\"policy\": \"" + std::string(policy_name(policy)) + "\", ";
+    handle << line + "\"throughput_op_per_sec\": " + std::to_string(res.tput) + ", \"p99_ms\": " +
+        std::to_string(res.p99) + ", \"jain_index\": " + std::to_string(res.jain) + "}\n";
+    for (auto& tg : targets) {
+        double share = sum ? tg.hist.count * 100 / sum : 0;
+        auto p99 = (double)tg.hist.percentile(99) / 1000000;
+        std::cout << "\t" << tg.name << ": " << share << "% (" << tg.hist.count << "), p99 " << p99 << " ms\n";
+        handle << line + "\"cu\": \"" + tg.name + "\", \"share_percent\": " + std::to_string(share) +
+            ", \"p99_ms\": " + std::to_string(p99) + "}\n";
+    }
+    std::cout << "\tspread: jain index " << res.jain << ", max/min " << (least ? (double)most / least : INFINITY);
+    std::cout << std::endl;
+    handle.close();
+    return res;
+}
+
+static int run_balancer(const Param& param, std::vector<Card>& cards, int policy)
+{
+    std::cout << "Test running...(pid: " << getpid() << ", " << cards.size() << " devices)\n";
+    for (auto& card : cards) {
+        std::cout << "device " << card.index << ": " << card.cus.size() << " cu(s) of " << param.kname << ":";
+        for (auto& cu : card.cus)
+            std::cout << " " << cu;
+        std::cout << std::endl;
+    }
+    std::vector<PolicyResult> res;
+    for (int p = POLICY_RR; p < POLICY_ALL; p++) {
+        if (policy == POLICY_ALL || policy == p)
+            res.push_back(run_balance(param, cards, p));
+    }
+    if (res.size() < 2)
+        return 0;
+    std::cout << "\npolicy\tops/s\t\tp99 ms\t\tjain index\n";
+    for (auto& r : res)
+        std::cout << policy_name(r.policy) << "\t" << r.tput << "\t" << r.p99 << "\t" << r.jain << std::endl;
+    return 0;
+}
+
+enum bringup_phase {
+    PHASE_OPEN = 0,
+    PHASE_LOAD = 1,
+    PHASE_KERNEL = 2,
+    PHASE_BO = 3,
+    PHASE_CLOSE = 4,
+    PHASE_MAX = 5,
+};
+
+static const char *phase_name[PHASE_MAX] = {"open", "load", "kernel", "bo pool", "close"};
+
+/*
+ * bring-up of one device, time of each phase in ms. the bo pool is the -t x -b bos
+ * a kernel run would allocate, each mapped. the close phase is freeing the bos and
+ * the kernel and closing the device, so the phases add up to the wall time.
+ */
+static void
+bringup(const Param& param, const std::string& xclbin, const std::string& index, std::vector<double>& ms)
+{
+    auto sz = get_value(param.bo_sz);
+    ms.assign(PHASE_MAX, 0);
+    Timer close;
+    {
+        Timer timer;
+        xrt::device device(std::atoi(index.c_str()));
+        timer.stop();
+        ms[PHASE_OPEN] = timer.elapsed();
+
+        timer = Timer();
+        auto uuid = device.load_xclbin(xclbin);
+        timer.stop();
+        ms[PHASE_LOAD] = timer.elapsed();
+
+        timer = Timer();
+        auto krnl = xrt::kernel(device, uuid.get(), param.kname, false);
+        timer.stop();
+        ms[PHASE_KERNEL] = timer.elapsed();
+
+        timer = Timer();
+        std::vector<xrt::bo> bos;
+        for (int i = 0; i < param.threads * param.bulk; i++) {
+            bos.emplace_back(device, sz, 0, krnl.group_id(0));
+            bos.back().map();
+        }
+        timer.stop();
+        ms[PHASE_BO] = timer.elapsed();
+        close = Timer();
+    }
+    close.stop();
+    ms[PHASE_CLOSE] = close.elapsed();
+}
+
+/*
+ * bring-up of all the devices, one after the other and all at once with a thread per
+ * device, -r rounds each, serial first unless par_first. every round opens the devices
+ * again. the first round of the first run is the first load by this process (cold,
+ * unless the card already had the xclbin), the rounds after reload the same xclbin
+ * (warm), so serial and parallel are compared on their warm rounds.
+ * a device failing in a parallel round is rethrown from its future once all the
+ * threads are done.
+ */
+static int run_bringup(const Param& param, const std::vector<std::string>& fxclbin,
+    const std::vector<std::string>& indexs, int rounds, bool par_first)
+{
+    if (fxclbin.size() != indexs.size())
+        throw std::runtime_error("\n-k and -d specified different number of devices");
+    size_t n = indexs.size();
+    std::ofstream handle(qor_csv_file, std::ofstream::app);
+    std::cout << "Test running...(pid: " << getpid() << ", " << n << " devices, bo pool of ";
+    std::cout << param.threads * param.bulk << " x " << param.bo_sz << " per device)\n";
+
+    const char *how[2] = {"serial", "parallel"};
+    double cold = 0;
+    double warm[2] = {0, 0};    // serial, parallel, sum of the warm rounds
+    int warms[2] = {0, 0};
+    int first = par_first ? 1 : 0;
+    for (int i = 0; i < 2; i++) {
+        int par = i ? !first : first;
+        std::cout << "\n" << how[par] << " bring-up:\n";
+        for (int r = 0; r < rounds; r++) {
+            std::vector<std::vector<double>> ms(n);
+            Timer timer;
+            if (par) {
+                std::vector<std::future<void>> futs;
+                for (size_t d = 0; d < n; d++)
+                    futs.push_back(std::async(std::launch::async, &bringup, std::cref(param), std::cref(fxclbin[d]),
+                        std::cref(indexs[d]), std::ref(ms[d])));
+                for (auto& f : futs)
+                    f.wait();
+                timer.stop();
+                for (auto& f : futs)
+                    f.get();
+            } else {
+                for (size_t d = 0; d < n; d++)
+                    bringup(param, fxclbin[d], indexs[d], ms[d]);
+                timer.stop();
+            }
+            bool is_cold = !i && !r;
+            if (is_cold) {
+                cold = timer.elapsed();
+            } else {
+                warm[par] += timer.elapsed();
+                warms[par]++;
+            }
+            std::cout << "\tround " << r + 1 << (is_cold ? " (cold)" : "") << ": " << timer.elapsed() << " ms\n";
+            for (size_t d = 0; d < n; d++) {
+                std::string line = "{\"bringup\": \"" + std::string(how[par]) + "\", \"round\": " +
+                    std::to_string(r + 1) + ", \"device_index\": \"" + indexs[d] + "\"";
+                std::cout << "\t  device " << indexs[d] << ":";
+                for (int p = 0; p < PHASE_MAX; p++) {
+                    std::cout << (p ? ", " : " ") << phase_name[p] << " " << ms[d][p] << " ms";
+                    line += ", \"" + std::string(phase_name[p]) + "_ms\": " + std::to_string(ms[d][p]);
+                }
+                std::cout << std::endl;
+                handle << line + "}\n";
+            }
+            handle << "{\"bringup\": \"" + std::string(how[par]) + "\", \"round\": " + std::to_string(r + 1) +
+                ", \"cold\": " + std::to_string(is_cold) + ", \"wall_ms\": " + std::to_string(timer.elapsed()) + "}\n";
+        }
+    }
+    handle.close();
+
+    std::cout << "\nbring-up of " << n << " devices:\n";
+    for (int par = 0; par < 2; par++) {
+        std::cout << "\t" << how[par] << ":";
+        if (par == first)
+            std::cout << " cold " << cold << " ms" << (warms[par] ? "," : "");
+        if (warms[par])
+            std::cout << " warm " << warm[par] / warms[par] << " ms";
+        std::cout << std::endl;
+    }
+    if (warms[0] && warms[1]) {
+        double ser = warm[0] / warms[0], par = warm[1] / warms[1];
+        std::cout << "\tparallel saves " << ser - par << " ms (" << (ser - par) * 100 / ser;
+        std::cout << "%) of warm serial bring-up\n";
+    }
+    return 0;
+}
+
 int run(int argc, char** argv, char *envp[])
 {
     std::string xclbin_fnm;
@@ -848,11 +1785,18 @@ int run(int argc, char** argv, char *envp[])
     int dir = INT_MAX;
     std::string boStr = "4k";
     std::string kname = DEF_KNAME + ":{" + DEF_KNAME + "_1}";
+    std::string pairs;
+    bool size_given = false;
+    bool single = false;
+    int policy = POLICY_ILLEGAL;
+    int cus = 0;
+    int rounds = 3;
+    std::string order = "serial";
     std::vector<char *> nargv;
     nargv.reserve(30);
     nargv.push_back(argv[0]);
     
-    while ((c = getopt(argc, argv, "b:d:hk:n:qs:t:D:LK:T:N:")) != -1) {
+    while ((c = getopt(argc, argv, "b:c:d:hk:n:qr:s:t:B:D:LK:O:P:ST:N:")) != -1) {
         switch (c)
         {
         case 'b':
@@ -878,6 +1822,7 @@ int run(int argc, char** argv, char *envp[])
             break;
         case 's':
             boStr = optarg;
+            size_given = true;
             nargv.push_back((char *)"-s");
             nargv.push_back(optarg);
             break;
@@ -907,6 +1852,24 @@ int run(int argc, char** argv, char *envp[])
             nargv.push_back((char *)"-L");
             nargv.push_back((char *)"");
             break;                      
+        case 'P':
+            pairs = optarg;
+            break;
+        case 'S':
+            single = true;
+            break;
+        case 'B':
+            policy = get_policy(optarg);
+            break;
+        case 'c':
+            cus = std::atoi(optarg);
+            break;
+        case 'r':
+            rounds = std::atoi(optarg);
+            break;
+        case 'O':
+            order = optarg;
+            break;
         case 'D':
             dir = std::atoi(optarg);
             nargv.push_back((char *)"-D");
@@ -924,10 +1887,120 @@ int run(int argc, char** argv, char *envp[])
     split(device_index, indexs);
     processes = fxclbin.size();
     Param param = {0, processes, threads, bulk, loop, time, lat,
-        quiet, "", dir, boStr, mode, run_type, kname, cu_type};
+        quiet, "", dir, boStr, mode, run_type, kname, cu_type, ""};
     MaxT maxT = {0};
     printCsvTitle(param);
 
+    if (run_type == RUN_TYPE_COPY) {
+        /*
+         * all the devices are opened in this process, xclbins are loaded and the
+         * kernel is only used for the default bank.
+         */
+        if (fxclbin.size() != indexs.size())
+            throw std::runtime_error("\n-k and -d specified different number of devices");
+        std::vector<CopyPair> cpairs;
+        parse_pairs(pairs.empty() ? (indexs.size() > 1 ? "0-0,0-1" : "0-0") : pairs, indexs.size(), cpairs);
+        std::vector<std::string> sizes = {"4k", "64k", "1m", "16m", "64m"};
+        if (size_given)
+            sizes = {boStr};
+        std::vector<xrt::device> devices;
+        std::vector<int> grps;
+        for (size_t i = 0; i < indexs.size(); i++) {
+            param.device_index = std::atoi(indexs[i].c_str());
+            param.xclbin_file = fxclbin[i];
+            check_param(param);
+            devices.emplace_back(param.device_index);
+            auto uuid = devices.back().load_xclbin(param.xclbin_file);
+            grps.push_back(xrt::kernel(devices.back(), uuid.get(), param.kname, false).group_id(0));
+        }
+        param.dir = INT_MAX;
+        param.processes = 1;
+        for (auto& p : cpairs) {
+            param.pair = p.name;
+            for (auto& sz : sizes) {
+                param.bo_sz = sz;
+                param.loop = loop;
+                regulate_dma_run_param(param);
+                run_copy(param, devices, grps, p, maxT);
+            }
+        }
+        return 0;
+    }
+
+    if (run_type == RUN_TYPE_BRINGUP) {
+        if (rounds <= 0)
+            throw std::runtime_error("\n-r specified error");
+        if (strcasecmp(order.c_str(), "serial") && strcasecmp(order.c_str(), "parallel"))
+            throw std::runtime_error("\n-O specified error");
+        param.device_index = std::atoi(indexs[0].c_str());
+        param.xclbin_file = fxclbin[0];
+        check_param(param);
+        for (auto& i : indexs) {
+            if ((unsigned int)std::atoi(i.c_str()) >= xclProbe())
+                throw std::runtime_error("\n-d specified error");
+        }
+        run_bringup(param, fxclbin, indexs, rounds, !strcasecmp(order.c_str(), "parallel"));
+        return 0;
+    }
+
+    if (policy != POLICY_ILLEGAL) {
+        /*
+         * one stream of cmds over all the devices, in this process like -S
+         */
+        if (policy < POLICY_RR || policy > POLICY_ALL)
+            throw std::runtime_error("\n-B specified error");
+        if (cus < 0)
+            throw std::runtime_error("\n-c specified error");
+        if (run_type != RUN_TYPE_KERNEL)
+            throw std::runtime_error("\n-B supported by kernel execution test only");
+        std::vector<Card> cards;
+        param.device_index = std::atoi(indexs[0].c_str());
+        param.xclbin_file = fxclbin[0];
+        check_param(param);
+        /* the kernel of -N, the cus are up to each xclbin */
+        param.kname = param.kname.substr(0, param.kname.find(":"));
+        open_cards(param, fxclbin, indexs, cards);
+        for (size_t i = 0; i < cards.size(); i++) {
+            cards[i].cus = kernel_cus(fxclbin[i], param.kname, cus);
+            if (cards[i].cus.empty())
+                throw std::runtime_error("\n" + fxclbin[i] + ": no cu of kernel " + param.kname);
+        }
+        param.processes = 1;
+        run_balancer(param, cards, policy);
+        return 0;
+    }
+
+    if (single) {
+        /*
+         * all the devices in this process, one combined result instead of one per
+         * child process. kernel and bo pool of each device are set up once.
+         */
+        std::vector<Card> cards;
+        param.device_index = std::atoi(indexs[0].c_str());
+        param.xclbin_file = fxclbin[0];
+        check_param(param);
+        for (auto& i : indexs) {
+            if ((unsigned int)std::atoi(i.c_str()) >= xclProbe())
+                throw std::runtime_error("\n-d specified error");
+        }
+        open_cards(param, fxclbin, indexs, cards);
+        param.processes = 1;
+        if (run_type == RUN_TYPE_KERNEL) {
+            run_cards(param, cards);
+        } else {
+            regulate_dma_run_param(param);
+            if (param.dir == INT_MAX) {
+                param.dir = XCL_BO_SYNC_BO_TO_DEVICE;
+                run_cards(param, cards);
+                param.dir = XCL_BO_SYNC_BO_FROM_DEVICE;
+                run_cards(param, cards);
+            } else {
+                run_cards(param, cards);
+            }
+        }
+        return 0;
+    }
+
     if (processes > 1) {
         /*
          * when running multiple process test, we don't print number for each process/thread,
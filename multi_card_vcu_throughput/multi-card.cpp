@@ -17,6 +17,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <string.h>
@@ -31,6 +32,9 @@
 #include <thread>
 #include <mutex>
 #include <future>
+#include <deque>
+#include <map>
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
 #include "boost/filesystem.hpp"
 
@@ -46,6 +50,17 @@ inline bool fileExist (const std::string& name) {
     struct stat buffer;   
     return (stat (name.c_str(), &buffer) == 0); 
 }
+
+/*
+ * frame accounting hooks of the decoder. plugin_dec calls vcu_frame_start() when a
+ * frame is sent to the decoder and vcu_frame_done() with the size of the frame's
+ * bitstream when the decoded frame is received, from any of its threads, with the
+ * instance id vcu_dec_test() was given. frames come out in order, so a done frame
+ * is the oldest one sent. a decoder not calling them only leaves the frame numbers
+ * out, the test result is still that of vcu_dec_test().
+ */
+extern "C" void vcu_frame_start(int instance);
+extern "C" void vcu_frame_done(int instance, size_t bytes);
 //
 
 std::mutex print_mutex;
@@ -53,6 +68,7 @@ const std::string csv_history_file = "tput_history.csv";
 const std::string qor_csv_file = "data_points.csv";
 const std::string EXT = "xxxxoooo";
 const std::string TMP = "tmpxxxxoooo/";
+const std::string EXT_VCU = "xxxxvcu";
 #define DEFAULT_COUNT (30000)
 #define DEFAULT_BULK (32)
 const std::string DEF_KNAME = "hello";
@@ -77,6 +93,7 @@ enum run_mode {
     MODE_MP = 2,
     MODE_MT = 3,
     MODE_SINGLE_RUN = 4,
+    MODE_SWEEP = 5,
 };
 
 static size_t get_value(std::string& szStr);
@@ -97,6 +114,7 @@ struct Param {
     int run_type;
     std::string& kname;
     int cu_type;
+    int streams;
 };
 
 struct Count {
@@ -134,6 +152,93 @@ public:
     }
 };
 
+/*
+ * decoded frames of one vcu session over all its streams, time stamps in ns
+ */
+struct VcuStats {
+    long start;
+    long end;
+    long busy;
+    size_t streams;
+    size_t frames;
+    size_t bytes;
+    std::deque<long> sent;
+    std::vector<long> lats;
+};
+
+/*
+ * one input stream, decoded by the session that takes it off the queue
+ */
+struct VcuStream {
+    int session;
+    int ret;
+    long start;
+    long end;
+    size_t frames;
+    size_t bytes;
+};
+
+class VcuQueue {
+    std::mutex mutex;
+    std::deque<int> streams;
+public:
+    void push(int s)
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        streams.push_back(s);
+    }
+
+    bool pop(int& s)
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        if (streams.empty())
+            return false;
+        s = streams.front();
+        streams.pop_front();
+        return true;
+    }
+};
+
+/*
+ * stats of the running sessions by their instance id, frames of an instance with no
+ * session are counted in vcu_lost
+ */
+static std::mutex vcu_mutex;
+static std::map<int, VcuStats*> vcu_stats;
+static size_t vcu_lost = 0;
+
+static long now_ns()
+{
+    return std::chrono::high_resolution_clock::now().time_since_epoch().count();
+}
+
+extern "C" void vcu_frame_start(int instance)
+{
+    auto start = now_ns();
+    const std::lock_guard<std::mutex> lock(vcu_mutex);
+    auto it = vcu_stats.find(instance);
+    if (it != vcu_stats.end())
+        it->second->sent.push_back(start);
+}
+
+extern "C" void vcu_frame_done(int instance, size_t bytes)
+{
+    auto end = now_ns();
+    const std::lock_guard<std::mutex> lock(vcu_mutex);
+    auto it = vcu_stats.find(instance);
+    if (it == vcu_stats.end()) {
+        vcu_lost++;
+        return;
+    }
+    auto stats = it->second;
+    stats->frames++;
+    stats->bytes += bytes;
+    if (!stats->sent.empty()) {
+        stats->lats.push_back(end - stats->sent.front());
+        stats->sent.pop_front();
+    }
+}
+
 class Cmd {
 public:    
     Cmd(const xrtDeviceHandle& device, const xrt::kernel& kernel, std::string& szStr,
@@ -302,6 +407,12 @@ void usage(char* exename)
     std::cout << "\t            default for one cu per kernel is \"hello:{hello_1}\"\n";
     std::cout << "\t            default for multiple cu per kernel is \"hello_1:{hello_1_1}\"\n";
     std::cout << "\t-D <dma dir> 0: to device, 1: from device. optional, default is bi-direction\n";
+    std::cout << "\t-v run vcu decode test, -t is number of decode sessions per device\n";
+    std::cout << "\t           fps, Mbit/s and frame latency are reported per session, per device and in total\n";
+    std::cout << "\t-S <streams> number of input streams queued per device for vcu test, optional,\n";
+    std::cout << "\t           default is one per session. a session takes the next stream when one is done\n";
+    std::cout << "\t-m sweep, vcu test with 1, 2, 4.. up to -t sessions, reports the number of concurrent\n";
+    std::cout << "\t           streams sustained before per stream fps drops below 90%\n";
     std::cout << "\t-h, help\n\n";
 }
 
@@ -376,9 +487,6 @@ static void printResult(const Param& param, const Timer& timer, const std::vecto
         if (!param.time && c != (size_t)param.loop)
             throw std::runtime_error("per thread count calculation error");
     }
-    if (param.run_type == RUN_TYPE_VCU){
-        res.count = param.threads;    
-    }
     if (!param.quiet) {
         std::ofstream handle(qor_csv_file, std::ofstream::app);
         std::string line = "{";
@@ -413,10 +521,8 @@ static void printResult(const Param& param, const Timer& timer, const std::vecto
                 std::cout << res.count << " transfers in " << timer.elapsed() << " ms)\n";
                 line +=  std::to_string(res.count * get_value(param.bo_sz) / timer.elapsed() / 1000); 
             } else {
-		if(param.run_type != RUN_TYPE_VCU){
-                    std::cout << "\tqueue length: " << param.bulk << std::endl;
-                    line += "\"queue length\": " + std::to_string(param.bulk) + ", ";
-		}
+                std::cout << "\tqueue length: " << param.bulk << std::endl;
+                line += "\"queue length\": " + std::to_string(param.bulk) + ", ";
                 std::cout << "\tthroughput: ";
                 line += "\"throughput ops/s\": ";
                 std::cout << res.count / timer.elapsed() * 1000 << " ops/s (";
@@ -614,6 +720,216 @@ static void handleProcessResult(const Param& param)
     handle.close();
 }
 
+/*
+ * p-th percentile of sorted frame latencies in ms
+ */
+static double lat_percentile(const std::vector<long>& lats, double p)
+{
+    if (lats.empty())
+        return 0;
+    size_t n = std::min(lats.size() - 1, (size_t)(p / 100 * lats.size()));
+    return (double)lats[n] / 1000000;
+}
+
+/*
+ * one line of decode result, ms is the period the frames are decoded in.
+ * lats are sorted in place.
+ */
+static void printVcuLine(const std::string& title, size_t frames, size_t bytes, double ms,
+    std::vector<long>& lats, std::string line, std::ofstream& handle)
+{
+    std::sort(lats.begin(), lats.end());
+    double fps = ms ? frames * 1000 / ms : 0;
+    double mbps = ms ? bytes * 8 / ms / 1000 : 0;
+    double p50 = lat_percentile(lats, 50);
+    double p90 = lat_percentile(lats, 90);
+    double p99 = lat_percentile(lats, 99);
+
+    std::cout << "\t" << title << ": " << fps << " fps, " << mbps << " Mbit/s (";
+    std::cout << frames << " frames in " << ms << " ms), latency p50/p90/p99: ";
+    std::cout << p50 << "/" << p90 << "/" << p99 << " ms\n";
+    line += "\"frames\": " + std::to_string(frames) + ", ";
+    line += "\"fps\": " + std::to_string(fps) + ", ";
+    line += "\"bitrate Mbit/s\": " + std::to_string(mbps) + ", ";
+    line += "\"p50 ms\": " + std::to_string(p50) + ", ";
+    line += "\"p90 ms\": " + std::to_string(p90) + ", ";
+    line += "\"p99 ms\": " + std::to_string(p99) + "}\n";
+    handle << line;
+}
+
+static void saveVcuResult(const Param& param, const Timer& timer, const std::vector<VcuStats>& stats)
+{
+    std::string file = TMP;
+    file += std::to_string(getppid());
+    file += "_";
+    file += std::to_string(getpid());
+    file += "_";
+    file += std::to_string(stats.size());
+    file += EXT_VCU;
+    if (!boost::filesystem::exists(TMP))
+        boost::filesystem::create_directory(TMP);
+    size_t frames = 0, bytes = 0;
+    for (auto& s : stats) {
+        frames += s.frames;
+        bytes += s.bytes;
+    }
+    std::ofstream handle(file);
+    handle << param.device_index << "\n";
+    handle << stats.size() << "\n";
+    handle << timer.start.time_since_epoch().count() << "\n";
+    handle << timer.end.time_since_epoch().count() << "\n";
+    handle << frames << "\n";
+    handle << bytes << "\n";
+    for (auto& s : stats) {
+        for (auto l : s.lats)
+            handle << l << "\n";
+    }
+    handle.close();
+}
+
+/*
+ * per session and per device decode result. fps of a session is over the time it is
+ * busy, busy % is over the whole test period, so is fps of the device.
+ * returns the average fps of a stream.
+ */
+static double printVcuResult(const Param& param, const Timer& timer, std::vector<VcuStats>& stats,
+    const std::vector<VcuStream>& streams, MaxT& maxT)
+{
+    const std::lock_guard<std::mutex> lock(print_mutex);
+    size_t frames = 0, bytes = 0;
+    std::vector<long> lats;
+    for (auto& s : stats) {
+        frames += s.frames;
+        bytes += s.bytes;
+        lats.insert(lats.end(), s.lats.begin(), s.lats.end());
+    }
+    saveVcuResult(param, timer, stats); // for multiple process
+
+    double sfps = 0, sfps_min = 0;
+    int decoded = 0;
+    for (auto& st : streams) {
+        if (st.ret == FALSE || st.ret == NOTSUPP || !st.frames)
+            continue;
+        double fps = (double)st.frames * 1000000000 / (st.end - st.start);
+        sfps_min = decoded ? std::min(sfps_min, fps) : fps;
+        sfps += fps;
+        decoded++;
+    }
+    if (decoded)
+        sfps /= decoded;
+
+    std::cout << "\nvcu decode throughput:\n";
+    std::cout << "\tdevice index: " << param.device_index << std::endl;
+    std::cout << "\tsession(s): " << stats.size() << std::endl;
+    std::cout << "\tstream(s): " << streams.size() << std::endl;
+    if (!frames) {
+        std::cout << "\tno frame reported by the decoder (vcu_frame_done)\n";
+        return 0;
+    }
+    std::ofstream handle(qor_csv_file, std::ofstream::app);
+    std::string line = "{\"device_index\": " + std::to_string(param.device_index) + ", ";
+    if (!param.quiet) {
+        for (size_t c = 0; c < stats.size(); c++) {
+            double busy = (double)stats[c].busy / 1000000;
+            double util = busy * 100 / timer.elapsed();
+            std::ostringstream title;
+            title << "session " << c << " (" << stats[c].streams << " stream(s), busy " << util << "%)";
+            printVcuLine(title.str(), stats[c].frames, stats[c].bytes, busy,
+                stats[c].lats, line + "\"session\": " + std::to_string(c) + ", \"streams\": " +
+                std::to_string(stats[c].streams) + ", \"busy %\": " + std::to_string(util) + ", ", handle);
+        }
+    }
+    std::cout << "\tper stream: " << sfps << " fps avg, " << sfps_min << " fps min (";
+    std::cout << decoded << " of " << streams.size() << " streams decoded)\n";
+    printVcuLine("device", frames, bytes, timer.elapsed(), lats,
+        line + "\"sessions\": " + std::to_string(stats.size()) + ", \"streams\": " +
+        std::to_string(streams.size()) + ", \"stream fps\": " + std::to_string(sfps) + ", ", handle);
+    handle.close();
+
+    MaxT nmaxT = {
+        param.processes,
+        (int)stats.size(),
+        param.bulk,
+        frames * 1000 / timer.elapsed(),
+    };
+    if (nmaxT.tput > maxT.tput)
+        maxT = std::move(nmaxT);
+    return sfps;
+}
+
+/*
+ * decode result of all the devices, each child process saves its device index, number
+ * of sessions, start and end time, frames, bytes and then frame latencies one per line,
+ * a file per run, so per sweep step. the results are merged per number of sessions.
+ */
+static void handleVcuResult(const Param& param)
+{
+    struct VcuDevice {
+        std::string index;
+        long start;
+        long end;
+        size_t frames;
+        size_t bytes;
+        std::vector<long> lats;
+    };
+    std::map<int, std::vector<VcuDevice>> steps;
+    std::ofstream handle(qor_csv_file, std::ofstream::app);
+
+    std::cout << "\nvcu decode throughput:\n";
+    std::cout << "\tprocess(es): " << param.processes << std::endl;
+    std::cout << "\tsession(s) per process: " << param.threads << std::endl;
+    if (!boost::filesystem::exists(TMP))
+        return;
+    boost::filesystem::directory_iterator dir(TMP), dend;
+    while (dir != dend) {
+        std::string fn = dir->path().filename().string();
+        std::string prefix = std::to_string(getpid()) + "_";    // <ppid>_ of the children
+        if (fn.rfind(EXT_VCU) != std::string::npos && !fn.compare(0, prefix.size(), prefix)) {
+            std::ifstream f(TMP + fn);
+            std::string ret;
+            VcuDevice d;
+            std::getline(f, d.index);
+            std::getline(f, ret);
+            int sessions = std::atoi(ret.c_str());
+            std::getline(f, ret);
+            d.start = std::atol(ret.c_str());
+            std::getline(f, ret);
+            d.end = std::atol(ret.c_str());
+            std::getline(f, ret);
+            d.frames = std::atol(ret.c_str());
+            std::getline(f, ret);
+            d.bytes = std::atol(ret.c_str());
+            while (std::getline(f, ret))
+                d.lats.push_back(std::atol(ret.c_str()));
+            f.close();
+            steps[sessions].push_back(std::move(d));
+        }
+        dir++;
+    }
+    boost::filesystem::remove_all(TMP);
+
+    for (auto& step : steps) {
+        long start = LLONG_MAX, end = LLONG_MIN;
+        size_t frames = 0, bytes = 0;
+        std::vector<long> lats;
+        std::string title = param.mode == MODE_SWEEP ? std::to_string(step.first) + " session(s), " : "";
+        std::string line = "\"sessions\": " + std::to_string(step.first) + ", ";
+        for (auto& d : step.second) {
+            printVcuLine(title + "device " + d.index, d.frames, d.bytes, (double)(d.end - d.start) / 1000000,
+                d.lats, "{\"device_index\": " + d.index + ", " + line, handle);
+            start = std::min(start, d.start);
+            end = std::max(end, d.end);
+            frames += d.frames;
+            bytes += d.bytes;
+            lats.insert(lats.end(), d.lats.begin(), d.lats.end());
+        }
+        if (frames)
+            printVcuLine(title + "all devices", frames, bytes, (double)(end - start) / 1000000, lats,
+                "{\"process\": " + std::to_string(param.processes) + ", " + line, handle);
+    }
+    handle.close();
+}
+
 static int make_p2(int n)
 {
     if (std::ceil(log2(n)) == std::floor(log2(n)))
@@ -630,6 +946,8 @@ static int get_mode(const char* str)
         return MODE_MP;
     if (!strcasecmp(str, "mt"))
         return MODE_MT;
+    if (!strcasecmp(str, "sweep"))
+        return MODE_SWEEP;
     return std::atoi(str);
 }
 
@@ -708,6 +1026,8 @@ run_multiple_process(std::vector<char*>& argv, char *envp[], const Param& param,
     }
 
     //handleProcessResult(param);
+    if (param.run_type == RUN_TYPE_VCU)
+        handleVcuResult(param);
 
     return 0;
 }
@@ -756,34 +1076,129 @@ thr0(std::vector<Cmd>& cmds, int loop, const Timer& timer)
     }
 }
 
-static int runVcu(const Param& param, MaxT& maxT)
+/*
+ * one decode session of the pool. the session keeps its instance id and takes the
+ * next queued stream once the current one is done, till the queue is empty.
+ */
+static void
+vcu_session(const Param& param, int session, VcuQueue& queue, VcuStats& stats, std::vector<VcuStream>& streams)
+{
+    int s;
+    int instance = TEST_INSTANCE_ID + session;
+    {
+        const std::lock_guard<std::mutex> lock(vcu_mutex);
+        vcu_stats[instance] = &stats;
+    }
+    stats.start = now_ns();
+    while (queue.pop(s)) {
+        auto& st = streams[s];
+        size_t frames, bytes;
+        {
+            const std::lock_guard<std::mutex> lock(vcu_mutex);
+            frames = stats.frames;
+            bytes = stats.bytes;
+        }
+        st.session = session;
+        st.start = now_ns();
+        st.ret = vcu_dec_test(param.xclbin_file.c_str(), instance, param.device_index);
+        st.end = now_ns();
+        const std::lock_guard<std::mutex> lock(vcu_mutex);
+        st.frames = stats.frames - frames;
+        st.bytes = stats.bytes - bytes;
+        stats.busy += st.end - st.start;
+        stats.streams++;
+        stats.sent.clear(); // frames still in the decoder of a failed stream
+    }
+    stats.end = now_ns();
+    const std::lock_guard<std::mutex> lock(vcu_mutex);
+    vcu_stats.erase(instance);
+}
+
+/*
+ * decodes the queued streams by a bounded pool of sessions, so no more than sessions
+ * streams are in the decoder at a time. returns the average fps of a stream.
+ */
+static double runVcu(const Param& param, int sessions, int nstreams, MaxT& maxT, int& ret)
 {
-    std::cout<< "running vcu_test\n";
+    std::cout << "running vcu_test (" << sessions << " session(s), " << nstreams << " stream(s))\n";
+    std::vector<VcuStats> stats(sessions);
+    std::vector<VcuStream> streams(nstreams);
+    VcuQueue queue;
+    for (int c = 0; c < nstreams; c++)
+        queue.push(c);
+    vcu_lost = 0;
+
     Timer timer(param.time);
+    std::vector<std::thread> thrs;
+    for (int c = 0; c < sessions; c++)
+        thrs.emplace_back(&vcu_session, std::cref(param), c, std::ref(queue), std::ref(stats[c]), std::ref(streams));
+    for (auto& t : thrs)
+        t.join();
+    timer.stop();
 
-    std::vector<std::future<int>> thrs;
+    int failed = 0, notsupp = 0, uncounted = 0;
+    for (auto& st : streams) {
+        if (st.ret == FALSE)
+            failed++;
+        else if (st.ret == NOTSUPP)
+            notsupp++;
+        else if (!st.frames)
+            uncounted++;
+    }
+    /*
+     * the decoder may not call the frame hooks, pass/fail is still that of vcu_dec_test(),
+     * only the frame numbers are missing
+     */
+    if (vcu_lost)
+        std::cout << "Warning: " << vcu_lost << " frame(s) reported for an instance id with no session\n";
+    if (uncounted) {
+        std::cout << "Warning: " << uncounted << " of " << nstreams << " streams decoded with no frame counted,";
+        std::cout << " the decoder does not call vcu_frame_start()/vcu_frame_done()\n";
+    }
+    if (failed) {
+        std::cout << "TEST FAILED (" << failed << " of " << nstreams << " streams)\n";
+        ret = EXIT_FAILURE;
+    } else if (notsupp) {
+        std::cout << "NOT SUPPORTED\n" << std::endl;
+        ret = EOPNOTSUPP;
+    } else {
+        std::cout << "TEST PASSED\n";
+    }
+    return printVcuResult(param, timer, stats, streams, maxT);
+}
 
-    for (int c = 0; c < param.threads; c++){
-        thrs.push_back(std::async(vcu_dec_test, param.xclbin_file.c_str(), TEST_INSTANCE_ID, param.device_index));
-//std::cout<<"a new thread launched"<<std::endl;
+/*
+ * sessions are doubled from 1 up to -t, with one stream per session or -S streams
+ * if more. the card sustains the most sessions whose per stream fps is still within
+ * 90% of that with a single session.
+ */
+static int runVcuSweep(const Param& param, MaxT& maxT)
+{
+    std::vector<std::pair<int, double>> fps;
+    int ret = 0;
+    for (int c = 1; ; c = std::min(c * 2, param.threads)) {
+        fps.emplace_back(c, runVcu(param, c, std::max(c, param.streams), maxT, ret));
+        if (ret || c == param.threads)
+            break;
     }
-    std::for_each(thrs.begin(), thrs.end(), [](std::future<int>& x){
-        int ret = x.get(); 
-        if (ret == FALSE) {
-          std::cout << "TEST FAILED\n";
-          return EXIT_FAILURE;
-        }
-        else if (ret == NOTSUPP) {
-          std::cout << "NOT SUPPORTED\n" << std::endl;
-          return EOPNOTSUPP;
-        }
-    });
-    std::cout << "TEST PASSED\n";
-    timer.stop();
-    //dummy cmd queue 
-    std::vector<std::vector<Cmd>> cmds;
-    printResult(param, timer, cmds, maxT);
-    return 0;
+
+    int sustained = 0;
+    std::cout << "\nvcu sessions sweep:\n";
+    std::cout << "\tdevice index: " << param.device_index << std::endl;
+    if (!fps[0].second) {
+        std::cout << "\tno frame counted, sustained concurrent streams unknown\n";
+        return ret;
+    }
+    bool dropped = false;
+    for (auto& f : fps) {
+        double rel = fps[0].second ? f.second * 100 / fps[0].second : 0;
+        std::cout << "\t" << f.first << " session(s): " << f.second << " fps per stream (" << rel << "%)\n";
+        dropped = dropped || rel < 90;
+        if (!dropped)
+            sustained = f.first;
+    }
+    std::cout << "\tsustained concurrent streams: " << sustained << std::endl;
+    return ret;
 }
 
 static int run(const Param& param, MaxT& maxT)
@@ -832,6 +1247,19 @@ static int run(const Param& param, MaxT& maxT)
     return 0;
 }
 
+/*
+ * -m is forwarded to the child processes, so it is checked before spawning them
+ */
+static void
+check_mode(const Param& param)
+{
+    if (param.mode != MODE_SINGLE_RUN && param.mode != MODE_SWEEP)
+        throw std::runtime_error("\n-m specified error, only sweep is supported");
+
+    if (param.mode == MODE_SWEEP && param.run_type != RUN_TYPE_VCU)
+        throw std::runtime_error("\n-m sweep is for vcu test only");
+}
+
 static void
 check_param(const Param& param)
 {
@@ -841,9 +1269,6 @@ check_param(const Param& param)
     if (param.device_index >= xclProbe())                                      
         throw std::runtime_error("\n-d specified error");
 
-    if (param.mode < MODE_TPUT || param.mode > MODE_SINGLE_RUN)
-        throw std::runtime_error("\n-m specified error");
-
     if (param.run_type < RUN_TYPE_DMA || param.run_type > RUN_TYPE_VCU)
         throw std::runtime_error("\n-K specified error");
 
@@ -862,6 +1287,9 @@ check_param(const Param& param)
     if (param.loop == 0)
         throw std::runtime_error("\n-n specified error");
 
+    if (param.streams < 0)
+        throw std::runtime_error("\n-S specified error");
+
     if (param.cu_type == KERNEL_CU_ILLEGAL)
         throw std::runtime_error("\n-c specified error");
     else if (param.cu_type == MULTI_KERNEL_WITH_ONE_CU_EACH)
@@ -893,6 +1321,7 @@ int run(int argc, char** argv, char *envp[])
     int mode = MODE_SINGLE_RUN;
     int run_type = RUN_TYPE_KERNEL;
     int cu_type = ONE_KERNEL_ONE_CU;
+    int streams = 0;
     double time = 0;
     int dir = INT_MAX;
     std::string boStr = "4k";
@@ -901,7 +1330,7 @@ int run(int argc, char** argv, char *envp[])
     nargv.reserve(30);
     nargv.push_back(argv[0]);
     
-    while ((c = getopt(argc, argv, "b:d:hk:n:qs:t:vD:LK:T:N:")) != -1) {
+    while ((c = getopt(argc, argv, "b:d:hk:m:n:qs:t:vD:LK:S:T:N:")) != -1) {
         switch (c)
         {
         case 'b':
@@ -915,6 +1344,11 @@ int run(int argc, char** argv, char *envp[])
         case 'k':    
             xclbin_fnm = optarg;
             break;
+        case 'm':
+            mode = get_mode(optarg);
+            nargv.push_back((char *)"-m");
+            nargv.push_back(optarg);
+            break;
         case 'n':
             loop = std::atoi(optarg);
             nargv.push_back((char *)"-n");
@@ -943,6 +1377,11 @@ int run(int argc, char** argv, char *envp[])
             nargv.push_back((char *)"-K");
             nargv.push_back(optarg);    
             break;                      
+        case 'S':
+            streams = std::atoi(optarg);
+            nargv.push_back((char *)"-S");
+            nargv.push_back(optarg);
+            break;
         case 'T':
             time = std::atof(optarg);
             nargv.push_back((char *)"-T");
@@ -976,9 +1415,10 @@ int run(int argc, char** argv, char *envp[])
     split(device_index, indexs);
     processes = fxclbin.size();
     Param param = {0, processes, threads, bulk, loop, time, lat,
-        quiet, "", dir, boStr, mode, run_type, kname, cu_type};
+        quiet, "", dir, boStr, mode, run_type, kname, cu_type, streams};
     MaxT maxT = {0};
     //printCsvTitle(param);
+    check_mode(param);
 
     if (processes > 1) {
         /*
@@ -1008,7 +1448,11 @@ int run(int argc, char** argv, char *envp[])
     if (run_type == RUN_TYPE_KERNEL) {
         run(param, maxT);
     } else if(run_type == RUN_TYPE_VCU) {
-        runVcu(param, maxT);    
+        if (param.mode == MODE_SWEEP)
+            return runVcuSweep(param, maxT);
+        int ret = 0;
+        runVcu(param, param.threads, param.streams ? param.streams : param.threads, maxT, ret);
+        return ret;
     } else {
         regulate_dma_run_param(param);
         if (param.dir == INT_MAX) {
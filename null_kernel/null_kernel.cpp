@@ -30,6 +30,8 @@
 #include <chrono>
 #include <thread>
 #include <future>
+#include <utility>
+#include <type_traits>
 #include <boost/algorithm/string.hpp>
 #include "boost/filesystem.hpp"
 
@@ -52,6 +54,7 @@ const std::string TMP = "tmpxxxxoooo/";
  * null_p:{null_p_1}  // 16 args
  */ 
 const std::string DEF_KNAME = "null_a";
+#define MAX_ARGS (26) // null_a to null_z
 
 enum kernel_cu {
     KERNEL_CU_ILLEGAL = 0,
@@ -72,6 +75,17 @@ enum run_mode {
     MODE_MP = 2,
     MODE_MT = 3,
     MODE_SINGLE_RUN = 4,
+    MODE_ARGS = 5,
+};
+
+enum kernel_arg_type {
+    ARG_ILLEGAL = 0,
+    ARG_U8 = 1,
+    ARG_U16 = 2,
+    ARG_U32 = 3,
+    ARG_U64 = 4,
+    ARG_BO = 5,
+    ARG_MIXED = 6,  // u32 and bo alternately
 };
 
 static size_t get_value(std::string& szStr);
@@ -92,6 +106,7 @@ struct Param {
     int run_type;
     std::string& kname;
     int cu_type;
+    int arg_type;
 };
 
 struct Count {
@@ -129,6 +144,127 @@ public:
     }
 };
 
+/*
+ * the kernel of the sweep point of -m args is not in the xclbin, or doesn't take
+ * the args of the type, which ends the sweep of the type
+ */
+struct ArgMismatch : std::runtime_error {
+    ArgMismatch(const std::string& what) : std::runtime_error(what) {}
+};
+
+/*
+ * kernel args, expanded at compile time. arg I of a scalar type T is I + 1,
+ * arg I of bo type is bos[I].
+ */
+struct Mixed {};
+
+template <typename T, size_t I>
+struct Arg {
+    static T get(std::vector<xrt::bo>&) { return T(I + 1); }
+    static const size_t bytes = sizeof(T);
+};
+
+template <size_t I>
+struct Arg<xrt::bo, I> {
+    static xrt::bo& get(std::vector<xrt::bo>& bos) { return bos[I]; }
+    static const size_t bytes = sizeof(uint64_t); // device address in the cmd
+};
+
+template <size_t I>
+struct Arg<Mixed, I> : Arg<typename std::conditional<I % 2, xrt::bo, uint32_t>::type, I> {};
+
+/* a run with the args set, not started */
+template <typename T, size_t... I>
+static xrt::run call_kernel(xrt::kernel& kernel, std::vector<xrt::bo>& bos, std::index_sequence<I...>)
+{
+    xrt::run run(kernel);
+    int set[] = {0, (run.set_arg(I, Arg<T, I>::get(bos)), 0)...};
+    (void)set;
+    return run;
+}
+
+template <typename T, size_t N>
+static xrt::run call_arity(xrt::kernel& kernel, std::vector<xrt::bo>& bos)
+{
+    return call_kernel<T>(kernel, bos, std::make_index_sequence<N>());
+}
+
+/* one call per arity, picked by the number of args at runtime */
+template <typename T, size_t... N>
+static xrt::run dispatch(xrt::kernel& kernel, std::vector<xrt::bo>& bos, int num_args, std::index_sequence<N...>)
+{
+    typedef xrt::run (*call)(xrt::kernel&, std::vector<xrt::bo>&);
+    static const call calls[] = {&call_arity<T, N + 1>...};
+    return calls[num_args - 1](kernel, bos);
+}
+
+template <typename T, size_t... I>
+static size_t arg_bytes(std::index_sequence<I...>)
+{
+    size_t bytes[] = {0, Arg<T, I>::bytes...};
+    size_t sum = 0;
+    for (auto b : bytes)
+        sum += b;
+    return sum;
+}
+
+/* bytes of the args in the cmd, table of each arity as dispatch() */
+template <typename T, size_t... N>
+static size_t arg_bytes(int num_args, std::index_sequence<N...>)
+{
+    static const size_t bytes[] = {arg_bytes<T>(std::make_index_sequence<N + 1>())...};
+    return bytes[num_args - 1];
+}
+
+static xrt::run setup_kernel(xrt::kernel& kernel, std::vector<xrt::bo>& bos, int num_args, int arg_type)
+{
+    auto seq = std::make_index_sequence<MAX_ARGS>();
+    switch (arg_type) {
+    case ARG_U8:
+        return dispatch<uint8_t>(kernel, bos, num_args, seq);
+    case ARG_U16:
+        return dispatch<uint16_t>(kernel, bos, num_args, seq);
+    case ARG_U64:
+        return dispatch<uint64_t>(kernel, bos, num_args, seq);
+    case ARG_BO:
+        return dispatch<xrt::bo>(kernel, bos, num_args, seq);
+    case ARG_MIXED:
+        return dispatch<Mixed>(kernel, bos, num_args, seq);
+    default:
+        return dispatch<uint32_t>(kernel, bos, num_args, seq);
+    }
+}
+
+static size_t cmd_arg_bytes(int num_args, int arg_type)
+{
+    auto seq = std::make_index_sequence<MAX_ARGS>();
+    switch (arg_type) {
+    case ARG_U8:
+        return arg_bytes<uint8_t>(num_args, seq);
+    case ARG_U16:
+        return arg_bytes<uint16_t>(num_args, seq);
+    case ARG_U64:
+        return arg_bytes<uint64_t>(num_args, seq);
+    case ARG_BO:
+        return arg_bytes<xrt::bo>(num_args, seq);
+    case ARG_MIXED:
+        return arg_bytes<Mixed>(num_args, seq);
+    default:
+        return arg_bytes<uint32_t>(num_args, seq);
+    }
+}
+
+static const char *arg_type_name(int arg_type)
+{
+    const char *name[] = {"illegal", "u8", "u16", "u32", "u64", "bo", "mixed"};
+    return name[arg_type];
+}
+
+static bool is_bo_arg(int arg_type, int i)
+{
+    return arg_type == ARG_BO || (arg_type == ARG_MIXED && i % 2);
+}
+
 class Cmd {
 public:    
     Cmd(const xrtDeviceHandle& device, const xrt::kernel& kernel, std::string& szStr,
@@ -137,11 +273,17 @@ public:
     {
     }
 
-    Cmd(const xrtDeviceHandle& device, const xrt::kernel& kernel, int num_args, std::string& szStr,
-       bool latency, int dir) :
+    Cmd(const xrtDeviceHandle& device, const xrt::kernel& kernel, int num_args, int arg_type,
+       std::string& szStr, bool latency, int dir) :
        kernel(kernel), lat(latency), bosync((xclBOSyncDirection)dir)
     {
         this->num_args = num_args;
+        this->arg_type = arg_type;
+        bos.resize(num_args);
+        for (int i = 0; i < num_args; i++) {
+            if (is_bo_arg(arg_type, i))
+                bos[i] = xrt::bo(device, get_value(szStr), 0, kernel.group_id(i));
+        }
     }
     void run()
     {
@@ -151,6 +293,13 @@ public:
             run_kernel_test();
     }
 
+    /* set the args of the kernel cmd, before the test starts */
+    void prepare()
+    {
+        if (!is_dma_test() && !cmd)
+            cmd = setup_kernel(kernel, bos, num_args, arg_type);
+    }
+
     bool done()
     {
         if (is_dma_test())
@@ -174,6 +323,8 @@ private:
     xclBOSyncDirection bosync;
     long stamp = 0;
     int num_args = 0;
+    int arg_type = ARG_U32;
+    std::vector<xrt::bo> bos;
 
     xrt::bo bo;
     void *hptr;
@@ -198,43 +349,8 @@ private:
 
     void run_kernel_test()
     {
-        if (cmd)
-            cmd.start();
-        else {
-            //cmd = kernel(bo);
-            if (num_args == 1)	
-                cmd = kernel(1);
-            else if (num_args == 2)	
-                cmd = kernel(1,2);
-            else if (num_args == 3)	
-                cmd = kernel(1,2,3);
-            else if (num_args == 4)	
-                cmd = kernel(1,2,3,4);
-            else if (num_args == 5)	
-                cmd = kernel(1,2,3,4,5);
-            else if (num_args == 6)	
-                cmd = kernel(1,2,3,4,5,6);
-            else if (num_args == 7)	
-                cmd = kernel(1,2,3,4,5,6,7);
-            else if (num_args == 8)	
-                cmd = kernel(1,2,3,4,5,6,7,8);
-            else if (num_args == 9)	
-                cmd = kernel(1,2,3,4,5,6,7,8,9);
-            else if (num_args == 10)	
-                cmd = kernel(1,2,3,4,5,6,7,8,9,10);
-            else if (num_args == 11)	
-                cmd = kernel(1,2,3,4,5,6,7,8,9,10,11);
-            else if (num_args == 12)	
-                cmd = kernel(1,2,3,4,5,6,7,8,9,10,11,12);
-            else if (num_args == 13)	
-                cmd = kernel(1,2,3,4,5,6,7,8,9,10,11,12,13);
-            else if (num_args == 14)	
-                cmd = kernel(1,2,3,4,5,6,7,8,9,10,11,12,13,14);
-            else if (num_args == 15)	
-                cmd = kernel(1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
-            else if (num_args == 16)	
-                cmd = kernel(1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16);
-	    }
+        prepare();
+        cmd.start();
         if (lat)
             stamp = std::chrono::high_resolution_clock::now().time_since_epoch().count();
     }
@@ -349,6 +465,12 @@ void usage(char* exename)
     std::cout << "\t                     eg. -t 4, will run 1, 2, 4 threads\n"; 
     std::cout << "\t                     eg. -t 9, will run 1, 2, 4, 8, 16 threads\n"; 
     std::cout << "\t           4:      single run with specified -b, -n | -T, -t, -p, -L, -K\n";
+    std::cout << "\t           5|args: cmd submission cost model, run null_a, null_b... with each arg type\n";
+    std::cout << "\t                   or the one of -a, fitting the cost per arg and per byte of args\n";
+    std::cout << "\t-a <arg type>, type of the kernel args, optional, default is 3\n";
+    std::cout << "\t           1|u8, 2|u16, 3|u32, 4|u64: scalar, arg i is i + 1\n";
+    std::cout << "\t           5|bo: bo of -s size\n";
+    std::cout << "\t           6|mixed: u32 and bo alternately\n";
     std::cout << "\t-h, help\n\n";
 }
 
@@ -401,7 +523,8 @@ static void printCsvTitle(const Param& param)
 }
 
 
-static void printResult(const Param& param, const Timer& timer, const std::vector<std::vector<Cmd>>& cmds, MaxT& maxT)
+static void printResult(const Param& param, const Timer& timer, const std::vector<std::vector<Cmd>>& cmds, MaxT& maxT,
+    double *tput)
 {
     Count res = {LLONG_MAX, LLONG_MIN, 0, 0};
     for (auto& t : cmds) {
@@ -494,6 +617,8 @@ static void printResult(const Param& param, const Timer& timer, const std::vecto
         param.bulk,
         res.count * 1000 /timer.elapsed(),
     };
+    if (tput)
+        *tput = nmaxT.tput;
     if (nmaxT.tput > maxT.tput)
         maxT = std::move(nmaxT);
             
@@ -672,6 +797,17 @@ static int get_mode(const char* str)
         return MODE_MP;
     if (!strcasecmp(str, "mt"))
         return MODE_MT;
+    if (!strcasecmp(str, "args"))
+        return MODE_ARGS;
+    return std::atoi(str);
+}
+
+static int get_arg_type(const char* str)
+{
+    for (int t = ARG_U8; t <= ARG_MIXED; t++) {
+        if (!strcasecmp(str, arg_type_name(t)))
+            return t;
+    }
     return std::atoi(str);
 }
 
@@ -796,17 +932,28 @@ thr0(std::vector<Cmd>& cmds, int loop, const Timer& timer)
     }
 }
 
-static int run(const Param& param, MaxT& maxT)
+/*
+ * run on the device with the xclbin loaded. load_ms is the time the xclbin took
+ * to load, printed if not negative. missing kernel or bad args are reported by
+ * ArgMismatch, see run_args().
+ */
+static int run(xrt::device& device, const xrt::uuid& uuid, double load_ms, const Param& param,
+    MaxT& maxT, double *tput = nullptr)
 {
-    auto device = xrt::device(param.device_index);
-    Timer timer_ld;
-    auto uuid = device.load_xclbin(param.xclbin_file);
-    timer_ld.stop();
-    auto krnl = xrt::kernel(device, uuid.get(), param.kname, false);
+    auto krnl = [&] {
+        try {
+            return xrt::kernel(device, uuid.get(), param.kname, false);
+        } catch (const std::exception& e) {
+            throw ArgMismatch(std::string(" no kernel ") + param.kname + ", " + e.what());
+        }
+    }();
     int num_args = param.kname[param.kname.find("_")+1] - 'a' + 1;
     int c; 
     int bulk = std::min(param.bulk, param.loop);
-    std::cout << "Test running...(pid: " << getpid() <<", xclbin loaded in " << timer_ld.elapsed() << " ms)\n";
+    std::cout << "Test running...(pid: " << getpid();
+    if (load_ms >= 0)
+        std::cout << ", xclbin loaded in " << load_ms << " ms";
+    std::cout << ")\n";
     std::vector<std::thread> thrs;
 
     /*
@@ -832,8 +979,13 @@ static int run(const Param& param, MaxT& maxT)
         }
     	std::cout << "num of args to kernel: " << num_args << std::endl;
     	for (int i = 0; i < bulk; i++) {
-        	auto cmd = Cmd(device, krnl, num_args, param.bo_sz, param.latency, param.dir);
-        	cmdlist.push_back(std::move(cmd));
+            try {
+                auto cmd = Cmd(device, krnl, num_args, param.arg_type, param.bo_sz, param.latency, param.dir);
+                cmd.prepare();
+                cmdlist.push_back(std::move(cmd));
+            } catch (const std::exception& e) {
+                throw ArgMismatch(std::string(" ") + arg_type_name(param.arg_type) + " args not taken, " + e.what());
+            }
     	}
        	cmds.push_back(std::move(cmdlist));
     }
@@ -854,11 +1006,126 @@ static int run(const Param& param, MaxT& maxT)
     }
     timer.stop();
 
-    printResult(param, timer, cmds, maxT);
+    printResult(param, timer, cmds, maxT, tput);
     
     return 0;
 }
 
+static int run(const Param& param, MaxT& maxT, double *tput = nullptr)
+{
+    auto device = xrt::device(param.device_index);
+    Timer timer_ld;
+    auto uuid = device.load_xclbin(param.xclbin_file);
+    timer_ld.stop();
+    return run(device, uuid, timer_ld.elapsed(), param, maxT, tput);
+}
+
+static double det3(const double m[3][3])
+{
+    return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+        m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+        m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+/*
+ * cmd submission cost model. null_a, null_b... are run with each arg type from 1
+ * arg up to the first arity failing, ie. the kernel is not in the xclbin or the
+ * arg type doesn't match its args, any other error fails the test. the xclbin is
+ * loaded once for all the points. the cost of a cmd is 1 / throughput, fitted by
+ * least squares to base + per arg x args for each arg type, and to
+ * base + per arg x args + per byte x bytes over all of them.
+ */
+static void run_args(Param& param, MaxT& maxT, bool type_given)
+{
+    struct Sample {
+        int type;
+        int args;
+        size_t bytes;
+        double us;
+    };
+    std::vector<Sample> samples;
+    std::vector<int> types = {ARG_U8, ARG_U16, ARG_U32, ARG_U64, ARG_BO, ARG_MIXED};
+    if (type_given)
+        types = {param.arg_type};
+    std::string kname = param.kname;
+    auto device = xrt::device(param.device_index);
+    Timer timer_ld;
+    auto uuid = device.load_xclbin(param.xclbin_file);
+    timer_ld.stop();
+    std::cout << "xclbin loaded in " << timer_ld.elapsed() << " ms\n";
+    for (auto t : types) {
+        param.arg_type = t;
+        for (int n = 1; n <= MAX_ARGS; n++) {
+            std::string k = "null_" + std::string(1, 'a' + n - 1);
+            param.kname = k + ":{" + k + "_1}";
+            double tput = 0;
+            try {
+                run(device, uuid, -1, param, maxT, &tput);
+            } catch (const ArgMismatch& e) {
+                std::cout << "arg type " << arg_type_name(t) << " stops at " << n << " args," << e.what() << "\n";
+                break;
+            }
+            samples.push_back({t, n, cmd_arg_bytes(n, t), 1000000 / tput});
+        }
+    }
+    param.kname = kname;
+
+    std::cout << "\nCmd submission cost, queue length: " << param.bulk << "\n";
+    std::cout << "\targ type\targs\tbytes\tus/cmd\n";
+    for (auto& sp : samples)
+        std::cout << "\t" << arg_type_name(sp.type) << "\t\t" << sp.args << "\t" << sp.bytes << "\t" << sp.us << "\n";
+
+    std::cout << "\targ type\tbase us\tus/arg\n";
+    for (auto t : types) {
+        double n = 0, mx = 0, my = 0, sxy = 0, sxx = 0;
+        for (auto& sp : samples) {
+            if (sp.type != t)
+                continue;
+            n++;
+            mx += sp.args;
+            my += sp.us;
+        }
+        if (n < 2)
+            continue;
+        mx /= n;
+        my /= n;
+        for (auto& sp : samples) {
+            if (sp.type != t)
+                continue;
+            sxy += (sp.args - mx) * (sp.us - my);
+            sxx += (sp.args - mx) * (sp.args - mx);
+        }
+        double slope = sxy / sxx;
+        std::cout << "\t" << arg_type_name(t) << "\t\t" << my - slope * mx << "\t" << slope << "\n";
+    }
+
+    /* normal equations of us = base + a x args + b x bytes, by Cramer's rule */
+    double m[3][3] = {}, v[3] = {};
+    for (auto& sp : samples) {
+        double x[3] = {1, (double)sp.args, (double)sp.bytes};
+        for (int i = 0; i < 3; i++) {
+            v[i] += x[i] * sp.us;
+            for (int j = 0; j < 3; j++)
+                m[i][j] += x[i] * x[j];
+        }
+    }
+    double det = det3(m);
+    if (std::fabs(det) < 1e-9 * std::max(1.0, m[2][2] * m[2][2] * m[0][0])) {
+        std::cout << "per byte cost needs arg types of different sizes\n";
+        return;
+    }
+    double coef[3];
+    for (int c = 0; c < 3; c++) {
+        double mc[3][3];
+        memcpy(mc, m, sizeof(m));
+        for (int i = 0; i < 3; i++)
+            mc[i][c] = v[i];
+        coef[c] = det3(mc) / det;
+    }
+    std::cout << "all arg types: " << coef[0] << " us + " << coef[1] << " us/arg + ";
+    std::cout << coef[2] << " us/byte\n";
+}
+
 static void
 check_param(const Param& param)
 {
@@ -868,9 +1135,12 @@ check_param(const Param& param)
     if (param.device_index >= xclProbe())                                      
         throw std::runtime_error("\n-d specified error");
 
-    if (param.mode < MODE_TPUT || param.mode > MODE_SINGLE_RUN)
+    if (param.mode < MODE_TPUT || param.mode > MODE_ARGS)
         throw std::runtime_error("\n-m specified error");
 
+    if (param.arg_type < ARG_U8 || param.arg_type > ARG_MIXED)
+        throw std::runtime_error("\n-a specified error");
+
     if (param.run_type < RUN_TYPE_DMA || param.run_type > RUN_TYPE_KERNEL)
         throw std::runtime_error("\n-K specified error");
 
@@ -907,6 +1177,8 @@ int run(int argc, char** argv, char *envp[])
     int mode = MODE_SINGLE_RUN;
     int run_type = RUN_TYPE_KERNEL;
     int cu_type = ONE_KERNEL_ONE_CU;
+    int arg_type = ARG_U32;
+    bool type_given = false;
     double time = 0;
     int dir = INT_MAX;
     std::string boStr = "4k";
@@ -915,9 +1187,15 @@ int run(int argc, char** argv, char *envp[])
     nargv.reserve(30);
     nargv.push_back(argv[0]);
     
-    while ((c = getopt(argc, argv, "b:c:d:hk:m:n:p:qs:t:D:LT:N:")) != -1) {
+    while ((c = getopt(argc, argv, "a:b:c:d:hk:m:n:p:qs:t:D:LT:N:")) != -1) {
         switch (c)
         {
+        case 'a':
+            arg_type = get_arg_type(optarg);
+            type_given = true;
+            nargv.push_back((char *)"-a");
+            nargv.push_back(optarg);
+            break;
         case 'b':
             bulk = std::atoi(optarg);
             nargv.push_back((char *)"-b");
@@ -988,7 +1266,7 @@ int run(int argc, char** argv, char *envp[])
     }                                   
   
     Param param = {device_index, processes, threads, bulk, loop, time, lat,
-        quiet, xclbin_fnm, dir, boStr, mode, run_type, kname, cu_type};
+        quiet, xclbin_fnm, dir, boStr, mode, run_type, kname, cu_type, arg_type};
     check_param(param);                     
     MaxT maxT = {0};
     printCsvTitle(param);
@@ -1018,6 +1296,10 @@ int run(int argc, char** argv, char *envp[])
         }
         if (run_type == RUN_TYPE_KERNEL)
             showTputResult(param, maxT);
+    } else if (mode == MODE_ARGS) { /*arg cost model. one 1 process is being used.*/
+        std::cout << "\nArgs test...\n";
+        param.processes = 1;
+        run_args(param, maxT, type_given);
     } else if (mode == MODE_MP) { /*multiple process test*/
         std::cout << "\nMultiple process test...\n";
         if (param.processes == 1) {
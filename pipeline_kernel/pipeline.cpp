@@ -30,6 +30,10 @@
 #include <chrono>
 #include <thread>
 #include <future>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
 #include <boost/algorithm/string.hpp>
 #include "boost/filesystem.hpp"
 
@@ -43,6 +47,7 @@ const std::string EXT = "xxxxoooo";
 const std::string TMP = "tmpxxxxoooo/";
 #define DEFAULT_COUNT (30000)
 #define DEFAULT_BULK (32)
+#define RETIRE_WAIT_MS (1)
 /*
  * the xclbin has 32 kernels, except the first and the last, the 30 in the
  * middle are all streaming kernels, no manipulation in host is required.
@@ -73,6 +78,8 @@ enum run_mode {
     MODE_MP = 2,
     MODE_MT = 3,
     MODE_SINGLE_RUN = 4,
+    MODE_OVERLAP = 5,
+    MODE_E2E = 6,
 };
 
 static size_t get_value(std::string& szStr);
@@ -93,6 +100,9 @@ struct Param {
     int run_type;
     std::string& kname;
     int cu_type;
+    int in_flight;
+    int out_flight;
+    int buffers;
 };
 
 struct Count {
@@ -252,6 +262,85 @@ private:
 
 };
 
+/*
+ * one side of the overlapped pipeline, either the m2s (producer) or the s2m (consumer).
+ * each run owns its bo, so up to depth frames of a side can be in flight at the same
+ * time. runs of a cu complete in order, so only the oldest outstanding run is polled.
+ */
+class Stage {
+public:
+    Stage(const xrt::device& device, const xrt::kernel& kernel, size_t sz, bool first, int depth) :
+        stamps(depth)
+    {
+        for (int i = 0; i < depth; i++) {
+            auto bo = xrt::bo(device, sz, 0, kernel.group_id(first ? 0 : 1));
+            xrt::run run(kernel);
+            run.set_arg(first ? 0 : 1, bo);
+            run.set_arg(2, sz/4);
+            bos.push_back(std::move(bo));
+            runs.push_back(std::move(run));
+        }
+    }
+
+    void issue()
+    {
+        stamps[tail] = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+        runs[tail].start();
+        if (++tail == runs.size())
+            tail = 0;
+        outstanding++;
+        issued++;
+    }
+
+    bool retire()
+    {
+        if (!outstanding)
+            return false;
+        switch (runs[head].state()) {
+            case ERT_CMD_STATE_COMPLETED:
+            case ERT_CMD_STATE_ERROR:
+            case ERT_CMD_STATE_ABORT:
+                busy += std::chrono::high_resolution_clock::now().time_since_epoch().count() - stamps[head];
+                if (++head == runs.size())
+                    head = 0;
+                outstanding--;
+                completed++;
+                return true;
+            default:
+                break;
+        }
+        return false;
+    }
+
+    /* block till the oldest outstanding run completes, or ms passed */
+    void wait_head(int ms)
+    {
+        if (outstanding)
+            runs[head].wait(std::chrono::milliseconds(ms));
+    }
+
+    size_t outstanding = 0;
+    long issued = 0;
+    long completed = 0;
+    /* sum of start to completion of all the runs, ns */
+    double busy = 0;
+
+private:
+    std::vector<xrt::bo> bos;
+    std::vector<xrt::run> runs;
+    std::vector<long> stamps;
+    size_t head = 0;
+    size_t tail = 0;
+};
+
+struct OverlapResult {
+    int in_flight;
+    int out_flight;
+    double fps;
+    double in_ms;
+    double out_ms;
+};
+
 static size_t get_value(std::string& szStr)
 {
     char c = szStr.back();
@@ -330,6 +419,17 @@ void usage(char* exename)
     std::cout << "\t                     eg. -t 4, will run 1, 2, 4 threads\n"; 
     std::cout << "\t                     eg. -t 9, will run 1, 2, 4, 8, 16 threads\n"; 
     std::cout << "\t           4:      single run with specified -b, -n | -T, -t, -p, -L, -K\n";
+    std::cout << "\t                   with -i or -o, runs the overlapped pipeline once with those limits\n";
+    std::cout << "\t           5|overlap: overlapped pipeline test, m2s and s2m runs are issued and completed\n";
+    std::cout << "\t                   independently, with m2s in flight 1, 2, 4... up to -i and s2m in flight\n";
+    std::cout << "\t                   1, 2, 4... up to -o. shows where frames/s stops scaling (back-pressure)\n";
+    std::cout << "\t           6|e2e: end to end test, each frame is h2c synced, run through m2s...s2m and c2h synced,\n";
+    std::cout << "\t                   with 1, 2 and 3 buffers (single, double, triple buffering) or -F buffers.\n";
+    std::cout << "\t                   shows frames/s, MB/s and the time of each stage per frame\n";
+    std::cout << "\t-F <buffers>, number of frame buffers of the e2e test, optional\n";
+    std::cout << "\t-i <m2s in flight>, maximum m2s (producer) runs in flight, optional, default is 32\n";
+    std::cout << "\t-o <s2m in flight>, maximum s2m (consumer) runs in flight, optional, default is 32\n";
+    std::cout << "\t           -i and -o apply to overlap mode and single run only\n";
     std::cout << "\t-h, help\n\n";
 }
 
@@ -364,6 +464,10 @@ static void printCsvTitle(const Param& param)
         line += "multi_thread_";
     } else if (param.mode == MODE_MP) {
         line += "multi_process_";
+    } else if (param.mode == MODE_OVERLAP) {
+        line += "overlap_";
+    } else if (param.mode == MODE_E2E) {
+        line += "end_to_end_";
     }
     if (param.run_type == RUN_TYPE_DMA) {
         line += "DMA\n";
@@ -651,6 +755,10 @@ static int get_mode(const char* str)
         return MODE_MP;
     if (!strcasecmp(str, "mt"))
         return MODE_MT;
+    if (!strcasecmp(str, "overlap"))
+        return MODE_OVERLAP;
+    if (!strcasecmp(str, "e2e"))
+        return MODE_E2E;
     return std::atoi(str);
 }
 
@@ -811,6 +919,402 @@ static int run(const Param& param, MaxT& maxT)
     return 0;
 }
 
+/*
+ * overlapped pipeline. unlike Cmd, which starts m2s and s2m as a pair and waits for both,
+ * the m2s runs and s2m runs here are tracked independently, each side keeps up to its own
+ * in flight limit. frames go through the stream chain in order, so the n-th s2m completion
+ * is the frame of the n-th m2s start, which gives the per frame latency.
+ * with -T, after the timer expires, the side behind is topped up to the other and both are
+ * drained, otherwise a s2m would be left waiting for a frame never sent.
+ */
+static OverlapResult
+run_overlap(const Param& param, xrt::device& device, const xrt::kernel& krnl_first,
+    const xrt::kernel& krnl_last, int in_max, int out_max)
+{
+    auto sz = get_value(param.bo_sz);
+    Stage m2s(device, krnl_first, sz, true, in_max);
+    Stage s2m(device, krnl_last, sz, false, out_max);
+    Count res = {LLONG_MAX, LLONG_MIN, 0, 0};
+    std::deque<long> starts;
+    long frames = param.time ? LONG_MAX : param.loop;
+
+    Timer timer(param.time);
+    while (s2m.completed < frames) {
+        if (frames == LONG_MAX && timer.expire())
+            frames = std::max(m2s.issued, s2m.issued);
+        while (m2s.outstanding < (size_t)in_max && m2s.issued < frames) {
+            m2s.issue();
+            if (param.latency)
+                starts.push_back(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+        }
+        while (s2m.outstanding < (size_t)out_max && s2m.issued < frames)
+            s2m.issue();
+        bool progress = false;
+        while (m2s.retire())
+            progress = true;
+        while (s2m.retire()) {
+            progress = true;
+            if (!param.latency || starts.empty())
+                continue;
+            auto delta = std::chrono::high_resolution_clock::now().time_since_epoch().count() - starts.front();
+            starts.pop_front();
+            res.min = std::min(res.min, delta);
+            res.max = std::max(res.max, delta);
+            res.avg = (delta + res.count * res.avg) / (res.count + 1);
+            res.count++;
+        }
+        /*
+         * nothing retired, so nothing more can be issued either. block on the run
+         * completing first rather than polling, m2s of a frame is done before its s2m
+         */
+        if (!progress)
+            (m2s.outstanding ? m2s : s2m).wait_head(RETIRE_WAIT_MS);
+    }
+    while (m2s.outstanding) {
+        if (!m2s.retire())
+            m2s.wait_head(RETIRE_WAIT_MS);
+    }
+    timer.stop();
+
+    OverlapResult ret = {in_max, out_max, s2m.completed / timer.elapsed() * 1000,
+        m2s.busy / m2s.completed / 1000000, s2m.busy / s2m.completed / 1000000};
+    if (param.quiet)
+        return ret;
+
+    std::ofstream handle(qor_csv_file, std::ofstream::app);
+    std::string line = "{\"m2s_in_flight\": " + std::to_string(in_max) + ", ";
+    line += "\"s2m_in_flight\": " + std::to_string(out_max) + ", ";
+    std::cout << "\noverlapped pipeline ";
+    std::cout << (param.latency ? "latency:\n" : "throughput:\n");
+    std::cout << "\tm2s in flight: " << in_max << std::endl;
+    std::cout << "\ts2m in flight: " << out_max << std::endl;
+    std::cout << "\tbo size: " << param.bo_sz << std::endl;
+    line += "\"bo_size\": \"" + param.bo_sz + "\", ";
+    std::cout << "\tthroughput: " << ret.fps << " frames/s (";
+    std::cout << s2m.completed << " frames in " << timer.elapsed() << " ms)\n";
+    line += "\"throughput_frame_per_sec\": " + std::to_string(ret.fps) + ", ";
+    /* Little's law, time averaged runs in flight = sum of run time / elapsed */
+    std::cout << "\tm2s: avg run " << ret.in_ms << " ms, avg in flight ";
+    std::cout << m2s.busy / 1000000 / timer.elapsed() << std::endl;
+    std::cout << "\ts2m: avg run " << ret.out_ms << " ms, avg in flight ";
+    std::cout << s2m.busy / 1000000 / timer.elapsed() << std::endl;
+    line += "\"m2s_avg_ms\": " + std::to_string(ret.in_ms) + ", ";
+    line += "\"s2m_avg_ms\": " + std::to_string(ret.out_ms);
+    if (param.latency) {
+        std::cout << "\tframe latency min: " << (double)res.min / 1000000 << " ms\n";
+        std::cout << "\tframe latency max: " << (double)res.max / 1000000 << " ms\n";
+        std::cout << "\tframe latency avg: " << (double)res.avg / 1000000 << " ms\n";
+        line += ", \"min_ms\": " + std::to_string((double)res.min / 1000000);
+        line += ", \"max_ms\": " + std::to_string((double)res.max / 1000000);
+        line += ", \"avg_ms\": " + std::to_string((double)res.avg / 1000000);
+    }
+    line += "}\n";
+    handle << line;
+    handle.close();
+
+    return ret;
+}
+
+/*
+ * frames/s of every m2s/s2m in flight pair. for each s2m in flight, back-pressure starts
+ * at the m2s in flight after which frames/s gains less than 5% -- from there on more
+ * frames pushed only wait in the stream chain, visible as the growing m2s run time.
+ */
+static void showOverlapResult(const std::vector<OverlapResult>& res, int in_max, int out_max)
+{
+    std::cout << "\nframes/s, m2s in flight (row) x s2m in flight (column):\n\t";
+    for (int o = 1; o <= out_max; o *= 2)
+        std::cout << "\t" << o;
+    std::cout << std::endl;
+    for (int i = 1; i <= in_max; i *= 2) {
+        std::cout << "\t" << i;
+        for (auto& r : res) {
+            if (r.in_flight == i)
+                std::cout << "\t" << (long)r.fps;
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << "\nback-pressure:\n";
+    for (int o = 1; o <= out_max; o *= 2) {
+        const OverlapResult *knee = nullptr, *last = nullptr;
+        for (auto& r : res) {
+            if (r.out_flight != o)
+                continue;
+            if (last && !knee && r.fps < last->fps * 1.05)
+                knee = last;
+            last = &r;
+        }
+        std::cout << "\ts2m in flight " << o << ": ";
+        if (!knee) {
+            std::cout << "none up to m2s in flight " << in_max << std::endl;
+            continue;
+        }
+        std::cout << "from m2s in flight " << knee->in_flight << " (" << (long)knee->fps;
+        std::cout << " frames/s), m2s run " << knee->in_ms << " ms -> " << last->in_ms;
+        std::cout << " ms at " << last->in_flight << std::endl;
+    }
+
+    auto best = res.front();
+    for (auto& r : res) {
+        if (r.fps > best.fps)
+            best = r;
+    }
+    std::cout << "\nMax throughput: " << best.fps << " frames/s\n";
+    std::cout << "@ m2s in flight: " << best.in_flight;
+    std::cout << " / s2m in flight: " << best.out_flight << std::endl;
+}
+
+static int run_overlap(const Param& param)
+{
+    auto device = xrt::device(param.device_index);
+    Timer timer_ld;
+    auto uuid = device.load_xclbin(param.xclbin_file);
+    timer_ld.stop();
+    auto krnl_first = xrt::kernel(device, uuid.get(), KNAME_FIRST, false);
+    auto krnl_last = xrt::kernel(device, uuid.get(), KNAME_LAST, false);
+    int in_max = param.in_flight ? param.in_flight : DEFAULT_BULK;
+    int out_max = param.out_flight ? param.out_flight : DEFAULT_BULK;
+    std::cout << "Test running...(pid: " << getpid() <<", xclbin loaded in " << timer_ld.elapsed() << " ms)\n";
+
+    if (param.mode != MODE_OVERLAP) {
+        run_overlap(param, device, krnl_first, krnl_last, in_max, out_max);
+        return 0;
+    }
+
+    std::vector<OverlapResult> res;
+    in_max = make_p2(in_max);
+    out_max = make_p2(out_max);
+    for (int i = 1; i <= in_max; i *= 2) {
+        for (int o = 1; o <= out_max; o *= 2)
+            res.push_back(run_overlap(param, device, krnl_first, krnl_last, i, o));
+    }
+    showOverlapResult(res, in_max, out_max);
+
+    return 0;
+}
+
+enum e2e_stage {
+    STAGE_H2C = 0,
+    STAGE_KERNEL = 1,
+    STAGE_C2H = 2,
+    STAGE_MAX = 3,
+};
+
+static const char *stage_name[STAGE_MAX] = {"h2c", "kernel", "c2h"};
+
+/*
+ * buffer of the end to end test, the bos of one frame and the m2s/s2m runs on them.
+ */
+struct Slot {
+    xrt::bo bo_in;
+    xrt::bo bo_out;
+    xrt::run run_in;
+    xrt::run run_out;
+    long stamp;
+};
+
+/*
+ * hands the buffer index from one stage to the next, -1 tells the stage to exit.
+ */
+class SlotQueue {
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<int> q;
+public:
+    void push(int idx) {
+        std::lock_guard<std::mutex> lock(mtx);
+        q.push_back(idx);
+        cv.notify_one();
+    }
+    int pop() {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [this] { return !q.empty(); });
+        auto idx = q.front();
+        q.pop_front();
+        return idx;
+    }
+};
+
+/*
+ * one stage thread of the end to end test. each stage works on one frame at a time,
+ * with more than one buffer the stages work on different frames at the same time.
+ * a failing sync or run is kept in err and -1 is passed down in place of the frame,
+ * so the stages after it and run_e2e() stop too.
+ */
+static void
+e2e_stage(int stage, std::vector<Slot>& slots, size_t sz, SlotQueue& in, SlotQueue& out, double& busy,
+    std::exception_ptr& err)
+{
+    while (true) {
+        int s = in.pop();
+        if (s < 0) {
+            out.push(s);
+            return;
+        }
+        auto start = std::chrono::high_resolution_clock::now();
+        try {
+            switch (stage) {
+                case STAGE_H2C:
+                    slots[s].bo_in.sync(XCL_BO_SYNC_BO_TO_DEVICE, sz, 0);
+                    break;
+                case STAGE_KERNEL:
+                    slots[s].run_in.start();
+                    slots[s].run_out.start();
+                    slots[s].run_out.wait();
+                    slots[s].run_in.wait();
+                    break;
+                default:
+                    slots[s].bo_out.sync(XCL_BO_SYNC_BO_FROM_DEVICE, sz, 0);
+                    break;
+            }
+        } catch (...) {
+            err = std::current_exception();
+            out.push(-1);
+            return;
+        }
+        busy += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        out.push(s);
+    }
+}
+
+/*
+ * end to end transactions, a frame is synced to the device through bo_in, passes
+ * m2s -> ... -> s2m and is synced back from bo_out. with 2 (double buffering) or 3
+ * (triple buffering) buffers, the h2c of a frame overlaps the kernel and c2h of the
+ * frames before it. the stage with the highest busy time is the one limiting frames/s.
+ */
+static double
+run_e2e(const Param& param, xrt::device& device, const xrt::kernel& krnl_first,
+    const xrt::kernel& krnl_last, int buffers)
+{
+    auto sz = get_value(param.bo_sz);
+    std::vector<Slot> slots(buffers);
+    for (auto& s : slots) {
+        s.bo_in = xrt::bo(device, sz, 0, krnl_first.group_id(0));
+        s.bo_out = xrt::bo(device, sz, 0, krnl_last.group_id(1));
+        memset(s.bo_in.map(), 0x5a, sz);
+        s.run_in = xrt::run(krnl_first);
+        s.run_in.set_arg(0, s.bo_in);
+        s.run_in.set_arg(2, sz/4);
+        s.run_out = xrt::run(krnl_last);
+        s.run_out.set_arg(1, s.bo_out);
+        s.run_out.set_arg(2, sz/4);
+    }
+
+    SlotQueue queues[STAGE_MAX + 1];
+    double busy[STAGE_MAX] = {0};
+    std::exception_ptr errs[STAGE_MAX];
+    std::vector<std::thread> thrs;
+    for (int i = 0; i < STAGE_MAX; i++)
+        thrs.emplace_back(&e2e_stage, i, std::ref(slots), sz, std::ref(queues[i]),
+            std::ref(queues[i + 1]), std::ref(busy[i]), std::ref(errs[i]));
+
+    Count res = {LLONG_MAX, LLONG_MIN, 0, 0};
+    auto retire = [&](int s) {
+        auto delta = std::chrono::high_resolution_clock::now().time_since_epoch().count() - slots[s].stamp;
+        res.min = std::min(res.min, delta);
+        res.max = std::max(res.max, delta);
+        res.avg = (delta + res.count * res.avg) / (res.count + 1);
+        res.count++;
+    };
+
+    Timer timer(param.time);
+    long issued = 0;
+    bool failed = false;
+    while (param.time ? !timer.expire() : issued < param.loop) {
+        int s = issued < buffers ? issued : queues[STAGE_MAX].pop();
+        if (s < 0) {
+            failed = true;
+            break;
+        }
+        if (issued >= buffers)
+            retire(s);
+        slots[s].stamp = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+        queues[STAGE_H2C].push(s);
+        issued++;
+    }
+    while (!failed && res.count < (size_t)issued) {
+        int s = queues[STAGE_MAX].pop();
+        if (s < 0)
+            failed = true;
+        else
+            retire(s);
+    }
+    timer.stop();
+    queues[STAGE_H2C].push(-1);
+    for (auto& t : thrs)
+        t.join();
+    for (auto& e : errs) {
+        if (e)
+            std::rethrow_exception(e);
+    }
+
+    auto fps = res.count / timer.elapsed() * 1000;
+    if (param.quiet)
+        return fps;
+
+    std::ofstream handle(qor_csv_file, std::ofstream::app);
+    std::string line = "{\"buffers\": " + std::to_string(buffers) + ", ";
+    std::cout << "\nend to end pipeline:\n";
+    std::cout << "\tbuffers: " << buffers << std::endl;
+    std::cout << "\tbo size: " << param.bo_sz << std::endl;
+    line += "\"bo_size\": \"" + param.bo_sz + "\", ";
+    std::cout << "\tthroughput: " << fps << " frames/s (";
+    std::cout << res.count << " frames in " << timer.elapsed() << " ms)\n";
+    line += "\"throughput_frame_per_sec\": " + std::to_string(fps) + ", ";
+    std::cout << "\tbandwidth: " << fps * sz / 1000000 << " MB/s each direction\n";
+    line += "\"bandwidth_MB_per_sec\": " + std::to_string(fps * sz / 1000000) + ", ";
+    int bound = STAGE_H2C;
+    for (int i = 0; i < STAGE_MAX; i++) {
+        std::cout << "\t" << stage_name[i] << ": " << busy[i] / res.count << " ms/frame, busy ";
+        std::cout << busy[i] * 100 / timer.elapsed() << "%\n";
+        line += "\"" + std::string(stage_name[i]) + "_ms\": " + std::to_string(busy[i] / res.count) + ", ";
+        if (busy[i] > busy[bound])
+            bound = i;
+    }
+    std::cout << "\tbound by: " << stage_name[bound] << std::endl;
+    line += "\"bound_by\": \"" + std::string(stage_name[bound]) + "\"";
+    if (param.latency) {
+        std::cout << "\tframe latency min: " << (double)res.min / 1000000 << " ms\n";
+        std::cout << "\tframe latency max: " << (double)res.max / 1000000 << " ms\n";
+        std::cout << "\tframe latency avg: " << (double)res.avg / 1000000 << " ms\n";
+        line += ", \"min_ms\": " + std::to_string((double)res.min / 1000000);
+        line += ", \"max_ms\": " + std::to_string((double)res.max / 1000000);
+        line += ", \"avg_ms\": " + std::to_string((double)res.avg / 1000000);
+    }
+    line += "}\n";
+    handle << line;
+    handle.close();
+
+    return fps;
+}
+
+static int run_e2e(const Param& param)
+{
+    auto device = xrt::device(param.device_index);
+    Timer timer_ld;
+    auto uuid = device.load_xclbin(param.xclbin_file);
+    timer_ld.stop();
+    auto krnl_first = xrt::kernel(device, uuid.get(), KNAME_FIRST, false);
+    auto krnl_last = xrt::kernel(device, uuid.get(), KNAME_LAST, false);
+    std::cout << "Test running...(pid: " << getpid() <<", xclbin loaded in " << timer_ld.elapsed() << " ms)\n";
+
+    if (param.buffers) {
+        run_e2e(param, device, krnl_first, krnl_last, param.buffers);
+        return 0;
+    }
+
+    /* single, double and triple buffering */
+    double fps[3];
+    for (int b = 1; b <= 3; b++)
+        fps[b - 1] = run_e2e(param, device, krnl_first, krnl_last, b);
+    std::cout << "\nframes/s by buffers: 1: " << fps[0] << ", 2: " << fps[1];
+    std::cout << " (x" << fps[1] / fps[0] << "), 3: " << fps[2] << " (x" << fps[2] / fps[0] << ")\n";
+
+    return 0;
+}
+
 static void
 check_param(const Param& param)
 {
@@ -820,7 +1324,7 @@ check_param(const Param& param)
     if (param.device_index >= xclProbe())                                      
         throw std::runtime_error("\n-d specified error");
 
-    if (param.mode < MODE_TPUT || param.mode > MODE_SINGLE_RUN)
+    if (param.mode < MODE_TPUT || param.mode > MODE_E2E)
         throw std::runtime_error("\n-m specified error");
 
     if (param.run_type < RUN_TYPE_DMA || param.run_type > RUN_TYPE_KERNEL)
@@ -843,6 +1347,25 @@ check_param(const Param& param)
 
     if (param.cu_type != ONE_KERNEL_ONE_CU)
         throw std::runtime_error("\n-c specified not supported");
+
+    if (param.in_flight < 0 || param.out_flight < 0)
+        throw std::runtime_error("\n-i/-o specified error");
+
+    if ((param.in_flight || param.out_flight) && param.mode == MODE_E2E)
+        throw std::runtime_error("\n-i/-o not supported by e2e mode, -F sets the buffers");
+
+    if ((param.in_flight || param.out_flight) && param.mode != MODE_OVERLAP && param.mode != MODE_SINGLE_RUN)
+        throw std::runtime_error("\n-i/-o only supported by overlap mode or single run");
+
+    if ((param.mode == MODE_OVERLAP || param.in_flight || param.out_flight) &&
+        param.run_type != RUN_TYPE_KERNEL)
+        throw std::runtime_error("\n-i/-o and overlap mode only support kernel run type");
+
+    if (param.buffers < 0 || (param.buffers && param.mode != MODE_E2E))
+        throw std::runtime_error("\n-F specified error");
+
+    if (param.mode == MODE_E2E && param.run_type != RUN_TYPE_KERNEL)
+        throw std::runtime_error("\ne2e mode only supports kernel run type");
 }
 
 int run(int argc, char** argv, char *envp[])
@@ -861,13 +1384,16 @@ int run(int argc, char** argv, char *envp[])
     int cu_type = ONE_KERNEL_ONE_CU;
     double time = 0;
     int dir = INT_MAX;
+    int in_flight = 0;
+    int out_flight = 0;
+    int buffers = 0;
     std::string boStr = "4k";
     std::string kname = DEF_KNAME + ":{" + DEF_KNAME + "_1}";
     std::vector<char *> nargv;
     nargv.reserve(30);
     nargv.push_back(argv[0]);
     
-    while ((c = getopt(argc, argv, "b:c:d:hk:m:n:p:qs:t:D:LK:T:N:")) != -1) {
+    while ((c = getopt(argc, argv, "b:c:d:hi:k:m:n:o:p:qs:t:D:F:LK:T:N:")) != -1) {
         switch (c)
         {
         case 'b':
@@ -883,6 +1409,15 @@ int run(int argc, char** argv, char *envp[])
             nargv.push_back((char *)"-d");
             nargv.push_back(optarg);
             break;
+        case 'F':
+            buffers = std::atoi(optarg);
+            break;
+        case 'i':
+            in_flight = std::atoi(optarg);
+            break;
+        case 'o':
+            out_flight = std::atoi(optarg);
+            break;
         case 'k':    
             xclbin_fnm = optarg;
             nargv.push_back((char *)"-k");
@@ -945,11 +1480,29 @@ int run(int argc, char** argv, char *envp[])
     }                                   
   
     Param param = {device_index, processes, threads, bulk, loop, time, lat,
-        quiet, xclbin_fnm, dir, boStr, mode, run_type, kname, cu_type};
+        quiet, xclbin_fnm, dir, boStr, mode, run_type, kname, cu_type,
+        in_flight, out_flight, buffers};
     check_param(param);                     
     MaxT maxT = {0};
     printCsvTitle(param);
 
+    if (mode == MODE_E2E) {
+        std::cout << "\nEnd to end pipeline test...\n";
+        param.processes = 1;
+        param.threads = 1;
+        run_e2e(param);
+        return 0;
+    }
+
+    if (mode == MODE_OVERLAP || in_flight || out_flight) {
+        if (mode == MODE_OVERLAP)
+            std::cout << "\nOverlapped pipeline test...\n";
+        param.processes = 1;
+        param.threads = 1;
+        run_overlap(param);
+        return 0;
+    }
+
     if (mode == MODE_TPUT) { /*throughput test. one 1 process is being used.*/
         std::cout << "\nThroughput test...\n";
         param.processes = 1;